@@ -0,0 +1,154 @@
+// 关中断时长跟踪（irqsoff）：用 CP0 Count 给每段关中断的区间计时，记下最长的一段和直方图
+#include <defs.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <sync.h>
+#include <proc.h>
+#include <clock.h>
+#include <irqsoff.h>
+#include <asm/mipsregs.h>
+
+#if IRQSOFF_TRACE
+
+/* A window starts when interrupts go off and stops when they come back on:
+   - intr_disable and intr_enable, so every local_intr_save / local_intr_restore pair
+     that really turned them off, and the direct calls (syscalls and softirqs enable
+     them inside mips_trap). Their site is the return address of the call, which is in
+     the function of the critical section since __intr_save and __intr_restore are
+     always inlined.
+   - the exception entry, if the code it stopped had interrupts on, until the eret of
+     the same trap (mips_trap and forkret call irqsoff_stop). Its start site is the
+     exception code (IRQSOFF_SITE_TRAP), so a long page fault shows up as "trap 2".
+
+   Everything is called with interrupts off, so the tracer needs no lock. A window that
+   spans a context switch is charged to the process that ends it, which is right: the
+   interrupts were off the whole time. */
+
+static bool irqsoff_active;             // interrupts are off and a window is being timed
+static uint32_t irqsoff_stamp;          // CP0 Count when the current window started
+static uintptr_t irqsoff_site;          // where it started
+
+struct irqsoff_stat {
+    struct {
+        uint32_t cycles;                // the longest window since the last reset
+        uintptr_t start, stop;          // its sites
+        int pid;                        // the process that ended it
+    } max;
+    uint64_t total;                     // cycles with interrupts off, in all windows
+    size_t nr;                          // # of windows
+    size_t hist[IRQSOFF_NBUCKET];
+};
+
+static struct irqsoff_stat irqsoff_stat;
+
+void
+irqsoff_start(uintptr_t site) {
+    if (!irqsoff_active) {
+        irqsoff_active = 1;
+        irqsoff_site = site;
+        irqsoff_stamp = read_c0_count();
+    }
+}
+
+void
+irqsoff_stop(uintptr_t site) {
+    if (!irqsoff_active) {
+        return ;
+    }
+    uint32_t cycles = read_c0_count() - irqsoff_stamp;
+    irqsoff_active = 0;
+
+    int i = 0;
+    while (i < IRQSOFF_NBUCKET - 1 && (cycles >> (i + IRQSOFF_MIN_SHIFT)) != 0) {
+        i ++;
+    }
+    struct irqsoff_stat *stat = &irqsoff_stat;
+    stat->hist[i] ++;
+    stat->nr ++;
+    stat->total += cycles;
+    if (cycles > stat->max.cycles) {
+        stat->max.cycles = cycles;
+        stat->max.start = irqsoff_site, stat->max.stop = site;
+        stat->max.pid = (current != NULL) ? current->pid : -1;
+    }
+}
+
+// irqsoff_reset - forget the windows seen so far
+void
+irqsoff_reset(void) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    memset(&irqsoff_stat, 0, sizeof(irqsoff_stat));
+    local_intr_restore(intr_flag);
+}
+
+static void
+irqsoff_print_site(const char *what, uintptr_t site) {
+    if (IRQSOFF_SITE_IS_TRAP(site)) {
+        kprintf("  %-5s trap %d\n", what, site);
+    }
+    else {
+        kprintf("  %-5s %08x\n", what, site);
+    }
+}
+
+/* *
+ * irqsoff_print - print the longest window and the histogram. The sites are return
+ * addresses, tools/irqsoff.sh turns them into functions and lines with the kernel ELF.
+ * */
+void
+irqsoff_print(void) {
+    // a copy: printing goes through cons_putc, whose own windows would change the numbers
+    struct irqsoff_stat stat;
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    stat = irqsoff_stat;
+    local_intr_restore(intr_flag);
+
+    kprintf("irqsoff: max %d ns, pid %d\n", COUNT_TO_NSEC(stat.max.cycles), stat.max.pid);
+    irqsoff_print_site("start", stat.max.start);
+    irqsoff_print_site("stop", stat.max.stop);
+
+    // ns in total, without a 64-bit multiply: whole ticks of cycles are counted apart
+    size_t ticks = 0;
+    while (stat.total >= TIMER0_INTERVAL) {
+        stat.total -= TIMER0_INTERVAL, ticks ++;
+    }
+    kprintf("irqsoff: %d windows, %d ticks + %d ns with interrupts off\n",
+            stat.nr, ticks, COUNT_TO_NSEC((uint32_t)stat.total));
+    int i;
+    for (i = 0; i < IRQSOFF_NBUCKET; i ++) {
+        if (stat.hist[i] == 0) {
+            continue ;
+        }
+        if (i < IRQSOFF_NBUCKET - 1) {
+            kprintf("  < %9d ns %9d\n", COUNT_TO_NSEC(1 << (i + IRQSOFF_MIN_SHIFT)), stat.hist[i]);
+        }
+        else {
+            kprintf("  >=%9d ns %9d\n", COUNT_TO_NSEC(1 << (i - 1 + IRQSOFF_MIN_SHIFT)), stat.hist[i]);
+        }
+    }
+}
+
+#else /* !IRQSOFF_TRACE */
+
+void
+irqsoff_start(uintptr_t site) {
+}
+
+void
+irqsoff_stop(uintptr_t site) {
+}
+
+void
+irqsoff_reset(void) {
+}
+
+void
+irqsoff_print(void) {
+    kprintf("irqsoff: not built in, set IRQSOFF_TRACE in kern/debug/irqsoff.h.\n");
+}
+
+#endif /* IRQSOFF_TRACE */
+
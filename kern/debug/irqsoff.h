@@ -0,0 +1,21 @@
+// 关中断时长跟踪（irqsoff）的接口定义
+#ifndef __KERN_DEBUG_IRQSOFF_H__
+#define __KERN_DEBUG_IRQSOFF_H__
+
+#include <defs.h>
+
+#define IRQSOFF_TRACE           0           // 1: time every window with interrupts off, see irqsoff.c
+#define IRQSOFF_NBUCKET         20          // histogram buckets, bucket i: < 2^(i+6) CP0 Count cycles
+#define IRQSOFF_MIN_SHIFT       6           // the upper bound of bucket 0 is 2^IRQSOFF_MIN_SHIFT cycles
+
+// a window opened by the exception entry instead of intr_disable, its site is the exception code
+#define IRQSOFF_SITE_TRAP(excode)           ((uintptr_t)(excode))
+#define IRQSOFF_SITE_IS_TRAP(site)          ((site) < 32)
+
+void irqsoff_start(uintptr_t site);
+void irqsoff_stop(uintptr_t site);
+void irqsoff_reset(void);
+void irqsoff_print(void);
+
+#endif /* !__KERN_DEBUG_IRQSOFF_H__ */
+
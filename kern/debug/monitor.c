@@ -4,6 +4,11 @@
 #include <trap.h>
 #include <monitor.h>
 #include <kdebug.h>
+#include <ksm.h>
+#include <vmm.h>
+#include <proc.h>
+#include <alloc_prof.h>
+#include <irqsoff.h>
 
 /* *
  * Simple command-line kernel monitor useful for controlling the
@@ -20,6 +25,11 @@ struct command {
 static struct command commands[] = {
     {"help", "Display this list of commands.", mon_help},
     {"kerninfo", "Display information about the kernel.", mon_kerninfo},
+    {"ksm", "Display the pages shared and saved by same-page merging.", mon_ksm},
+    {"faultaround", "Display how many pages mapped by fault-around were touched.", mon_faultaround},
+    {"procmem", "Display the fixed memory cost of a process and the deepest kernel stack.", mon_procmem},
+    {"allocprof", "Display the kernel memory by allocation call site.", mon_allocprof},
+    {"irqsoff", "Display the longest time interrupts were off, and a histogram.", mon_irqsoff},
 };
 
 /* return if kernel is panic, in kern/debug/panic.c */
@@ -124,3 +134,38 @@ mon_kerninfo(int argc, char **argv, struct trapframe *tf) {
     return 0;
 }
 
+/* mon_ksm - call ksm_print_stat in kern/mm/ksm.c to print the merging statistics */
+int
+mon_ksm(int argc, char **argv, struct trapframe *tf) {
+    ksm_print_stat();
+    return 0;
+}
+
+/* mon_faultaround - call print_fault_around_stat in kern/mm/vmm.c */
+int
+mon_faultaround(int argc, char **argv, struct trapframe *tf) {
+    print_fault_around_stat();
+    return 0;
+}
+
+/* mon_procmem - call print_proc_overhead in kern/process/proc.c */
+int
+mon_procmem(int argc, char **argv, struct trapframe *tf) {
+    print_proc_overhead();
+    return 0;
+}
+
+/* mon_allocprof - call alloc_prof_print in kern/mm/alloc_prof.c */
+int
+mon_allocprof(int argc, char **argv, struct trapframe *tf) {
+    alloc_prof_print();
+    return 0;
+}
+
+/* mon_irqsoff - call irqsoff_print in kern/debug/irqsoff.c */
+int
+mon_irqsoff(int argc, char **argv, struct trapframe *tf) {
+    irqsoff_print();
+    return 0;
+}
+
@@ -7,6 +7,11 @@ void monitor(struct trapframe *tf);
 
 int mon_help(int argc, char **argv, struct trapframe *tf);
 int mon_kerninfo(int argc, char **argv, struct trapframe *tf);
+int mon_ksm(int argc, char **argv, struct trapframe *tf);
+int mon_faultaround(int argc, char **argv, struct trapframe *tf);
+int mon_procmem(int argc, char **argv, struct trapframe *tf);
+int mon_allocprof(int argc, char **argv, struct trapframe *tf);
+int mon_irqsoff(int argc, char **argv, struct trapframe *tf);
 
 #endif /* !__KERN_DEBUG_MONITOR_H__ */
 
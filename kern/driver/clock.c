@@ -1,36 +1,177 @@
 #include <thumips.h>
 #include <trap.h>
 #include <stdio.h>
+#include <assert.h>
+#include <sync.h>
 #include <picirq.h>
 #include <sched.h>
+#include <hrtimer.h>
+#include <softirq.h>
+#include <clock.h>
 #include <asm/mipsregs.h>
 
 volatile size_t ticks;
 
-#define TIMER0_INTERVAL  1000000 
+/* The tick is due when CP0 Count reaches next_tick, which always moves on by whole
+   TIMER0_INTERVALs, so ticks keeps counting real time even when some interrupts are
+   late or, in tickless idle, not taken at all: clock_catch_up adds every interval
+   that has passed.
 
-static void reload_timer()
-{
-  uint32_t counter = read_c0_count();
-  counter += TIMER0_INTERVAL;
-  write_c0_compare(counter);
+   Compare is shared by the tick and the hrtimers, clock_reprogram sets it to whichever
+   comes first: next_tick (nohz_target while the tick is stopped) or the first hrtimer.
+
+   clock_read extends the 32-bit Count to 64 bits, and keeps the time since boot in
+   seconds and Count cycles as well, so that no 64-bit divide is needed to tell it. It
+   must see every wrap of Count, about every 43s at COUNT_FREQ, which the timer
+   interrupt takes care of: it comes at least every TVR_SIZE ticks. */
+static uint32_t next_tick;
+static bool tick_stopped;               // Compare is set beyond next_tick by clock_nohz_enter
+static uint32_t nohz_target;
+
+static uint32_t clock_last, clock_hi;   // Count at the last clock_read, and the # of wraps
+static uint32_t mono_sec, mono_count;   // the time of the last clock_read, mono_count < COUNT_FREQ
+
+// clock_read - the CP0 Count cycles since boot, called with interrupts disabled
+uint64_t
+clock_read(void) {
+  uint32_t now = read_c0_count();
+  if (now < clock_last) {
+    clock_hi ++;
+  }
+  mono_count += now - clock_last;
+  while (mono_count >= COUNT_FREQ) {
+    mono_count -= COUNT_FREQ;
+    mono_sec ++;
+  }
+  clock_last = now;
+
+  union {
+    uint64_t cycles;
+    struct {
+      uint32_t lo, hi;                  // little endian
+    } w;
+  } c;
+  c.w.lo = now, c.w.hi = clock_hi;
+  return c.cycles;
+}
+
+// clock_gettime_mono - the time since boot in seconds and nanoseconds
+void
+clock_gettime_mono(struct timespec *ts) {
+  bool intr_flag;
+  local_intr_save(intr_flag);
+  {
+    clock_read();
+    ts->tv_sec = mono_sec;
+    ts->tv_nsec = COUNT_TO_NSEC(mono_count);
+  }
+  local_intr_restore(intr_flag);
+}
+
+// timespec_to_count - the Count cycles of ts, using only 64-bit additions
+uint64_t
+timespec_to_count(const struct timespec *ts) {
+  uint64_t count = NSEC_TO_COUNT(ts->tv_nsec), freq = COUNT_FREQ;
+  uint32_t sec = ts->tv_sec;
+  while (sec != 0) {
+    if (sec & 1) {
+      count += freq;
+    }
+    freq += freq, sec >>= 1;
+  }
+  return count;
+}
+
+static void
+clock_catch_up(void) {
+  while ((int32_t)(read_c0_count() - next_tick) >= 0) {
+    ticks ++;
+    next_tick += TIMER0_INTERVAL;
+  }
+}
+
+/* *
+ * clock_reprogram - set Compare to the next tick or the first hrtimer, whichever comes
+ * first; called with interrupts disabled. Writing Compare also clears the timer interrupt.
+ * */
+void
+clock_reprogram(void) {
+  uint32_t target;
+  do {
+    if (tick_stopped && (int32_t)(read_c0_count() - nohz_target) >= 0) {
+      tick_stopped = 0;
+    }
+    if (!tick_stopped) {
+      clock_catch_up();
+    }
+    target = tick_stopped ? nohz_target : next_tick;
+
+    uint64_t expires, now = clock_read();
+    uint32_t lo = (uint32_t)now;
+    if (hrtimer_next(&expires)) {
+      if (expires <= now) {
+        target = lo + HRTIMER_MIN_DELTA;
+      }
+      else if (expires - now < (uint64_t)(target - lo)) {
+        target = (uint32_t)expires;
+      }
+    }
+    write_c0_compare(target);
+  } while ((int32_t)(read_c0_count() - target) >= 0);
 }
 
-//时钟中断处理函数
+//时钟中断处理函数：可能是 tick 到了，也可能只是某个 hrtimer 到期了
+//定时器轮与调度 tick 交给 TIMER_SOFTIRQ，开着中断做；hrtimer 要准时，留在这里
 int clock_int_handler(void * data)
 {
-  ticks++;
+  size_t oticks = ticks;
+  tick_stopped = 0;
+  clock_catch_up();
+  hrtimer_run(clock_read());
 //  if( (ticks & 0x1F) == 0)
 //    cons_putc('A');
-  run_timer_list();  
-  reload_timer(); 
+  if (ticks != oticks) {
+    raise_softirq(TIMER_SOFTIRQ);
+  }
+  clock_reprogram(); 
   return 0;
 }
 
+/* *
+ * clock_nohz_enter - called by cpu_idle with interrupts disabled: skip the ticks before
+ * the next event, due in delta ticks (see sched_next_event). Nothing is done if a tick
+ * is already pending. An hrtimer due earlier still gets its interrupt.
+ * */
+void
+clock_nohz_enter(size_t delta) {
+  if (delta <= 1 || (int32_t)(read_c0_count() - next_tick) >= 0) {
+    return ;
+  }
+  nohz_target = next_tick;
+  while (-- delta > 0) {
+    nohz_target += TIMER0_INTERVAL;
+  }
+  tick_stopped = 1;
+  clock_reprogram();
+}
+
+// clock_nohz_exit - called with interrupts disabled when cpu_idle wakes up: count the
+//                 - ticks skipped and start the periodic tick again
+void
+clock_nohz_exit(void) {
+  if (tick_stopped) {
+    tick_stopped = 0;
+    clock_reprogram();
+  }
+}
+
 //初始化Clock计数器，开启TIMER0_IRQ的中断
 void
 clock_init(void) {
-  reload_timer(); 
+  static_assert(COUNT_FREQ == 100000000);     // COUNT_TO_NSEC and NSEC_TO_COUNT assume it
+  clock_last = read_c0_count();
+  next_tick = clock_last + TIMER0_INTERVAL;
+  clock_reprogram(); 
   pic_enable(TIMER0_IRQ);
   kprintf("++setup timer interrupts\n");
 }
@@ -2,10 +2,26 @@
 #define __KERN_DRIVER_CLOCK_H__
 
 #include <defs.h>
+#include <thumips.h>
+#include <time.h>
+
+#define COUNT_FREQ                  100000000   // CP0 Count cycles per second, QEMU's 100MHz
+#define TIMER0_INTERVAL             1000000     // CP0 Count cycles per tick
+#define HRTIMER_MIN_DELTA           100         // the soonest a timer interrupt can be set up
+
+// valid for a COUNT_FREQ of 100MHz, 10ns per cycle; there is no divide
+#define COUNT_TO_NSEC(c)            __mulu10(c)
+#define NSEC_TO_COUNT(ns)           __divu10(ns)
 
 extern volatile size_t ticks;
 
 void clock_init(void);
+uint64_t clock_read(void);
+void clock_gettime_mono(struct timespec *ts);
+uint64_t timespec_to_count(const struct timespec *ts);
+void clock_reprogram(void);
+void clock_nohz_enter(size_t delta);
+void clock_nohz_exit(void);
 
 #endif /* !__KERN_DRIVER_CLOCK_H__ */
 
@@ -9,6 +9,8 @@
 #include <trap.h>
 #include <memlayout.h>
 #include <sync.h>
+#include <softirq.h>
+#include <console.h>
 
 /* stupid I/O delay routine necessitated by historical PC design flaws */
 static void
@@ -96,17 +98,33 @@ serial_proc_data(void) {
     return c;
 }
 
-//串口处理函数
+#define SERIAL_BH_BUDGET            64      // characters serial_bh hands to stdin in one run
+
+static tasklet_t serial_tasklet;
+
+//串口处理函数（上半部）：把串口 FIFO 里的字符收进 cons.buf（读走即应答），其余交给 serial_bh
 void serial_int_handler(void *opaque)
 {
   unsigned char id = inb(COM1+COM_IIR);
   //如果此时有东西发送，则直接返回
   if(id & 0x01)
     return ;
-  //int c = serial_proc_data();
-  int c = cons_getc(c);
+  serial_intr();
+  tasklet_schedule(&serial_tasklet);
+}
+
+//串口下半部：开着中断把 cons.buf 里的字符交给 stdin 并唤醒读者，一次最多 SERIAL_BH_BUDGET 个
+static void
+serial_bh(void *data) {
   extern void dev_stdin_write(char c);
-  dev_stdin_write(c);
+  int n, c;
+  for (n = 0; n < SERIAL_BH_BUDGET; n ++) {
+    if ((c = cons_getc()) == 0) {
+      return ;
+    }
+    dev_stdin_write(c);
+  }
+  tasklet_schedule(&serial_tasklet);
 }
 
 /* *
@@ -151,6 +169,7 @@ serial_intr(void) {
 /* cons_init - initializes the console devices */
 void
 cons_init(void) {
+    tasklet_init(&serial_tasklet, serial_bh, NULL);
     serial_init();
     //cons.rpos = cons.wpos = 0;
     if (!serial_exists) {
@@ -1,6 +1,7 @@
 #include <thumips.h>
 #include <intr.h>
 #include <asm/mipsregs.h>
+#include <irqsoff.h>
 
 #define get_status(x) __asm volatile("mfc0 %0,$12" : "=r" (x))
 #define set_status(x) __asm volatile("mtc0 %0,$12" :: "r" (x))
@@ -9,6 +10,9 @@
 void
 intr_enable(void) {
 	uint32_t x;
+	if (IRQSOFF_TRACE) {
+		irqsoff_stop((uintptr_t)__builtin_return_address(0));
+	}
 	get_status(x);
 	x |= ST0_IE;
 	set_status(x);
@@ -19,7 +23,9 @@ void
 intr_disable(void) {
 	uint32_t x;
 	get_status(x);
-	x &= ~ST0_IE;
-	set_status(x);
+	set_status(x & ~ST0_IE);
+	if (IRQSOFF_TRACE && (x & ST0_IE)) {
+		irqsoff_start((uintptr_t)__builtin_return_address(0));
+	}
 }
 
@@ -3,13 +3,16 @@
 
 #include <thumips.h>
 #include <asm/mipsregs.h>
+#include <preempt.h>
 
 void intr_enable(void);
 void intr_disable(void);
 
-//关闭本地中断，并将原来的中断标志保存在flags变量中
-static inline bool
+//关闭本地中断，并将原来的中断标志保存在flags变量中；关中断的区域同时禁止抢占
+//总是内联：irqsoff 跟踪把 intr_disable / intr_enable 的返回地址当作临界区所在的位置
+static __always_inline bool
 __intr_save(void) {
+  preempt_disable();
   //如果此时禁止中断，那么直接return 0
   if (!(read_c0_status() & ST0_IE)) {
     return 0;
@@ -20,8 +23,10 @@ __intr_save(void) {
 }
 
 //恢复保存在flags变量中的中断状态
-static inline void
+static __always_inline void
 __intr_restore(bool flag) {
+    // 中断打开后来的时钟中断会在返回时检查抢占，这里不用检查
+    preempt_enable_no_resched();
     if (flag) {
         intr_enable();
     }
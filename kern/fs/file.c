@@ -10,33 +10,52 @@
 #include <dirent.h>
 #include <error.h>
 #include <assert.h>
+#include <kmalloc.h>
 
 #define testfd(fd)                          ((fd) >= 0 && (fd) < FS_STRUCT_NENTRY)
 
-static struct file *
-get_filemap(void) {
+static struct fs_struct *
+get_fs_struct(void) {
     struct fs_struct *fs_struct = current->fs_struct;
     assert(fs_struct != NULL);
     assert(fs_count(fs_struct) > 0);
-    return fs_struct->filemap;
+    return fs_struct;
 }
 
-void
-filemap_init(struct file *filemap) {
-    int fd;
-    struct file *file = filemap;
-    for (fd = 0; fd < FS_STRUCT_NENTRY; fd ++, file ++) {
+//filemap_grow - allocate the filemap chunk holding fd. The chunks never move, so a struct file
+//             - stays valid while another thread sharing the fs_struct opens more files
+int
+filemap_grow(struct fs_struct *fs_struct, int fd) {
+    assert(testfd(fd) && filemap_get(fs_struct, fd) == NULL);
+    struct file *file;
+    if ((file = kmalloc(FILEMAP_CHUNK_NENTRY * sizeof(struct file))) == NULL) {
+        return -E_NO_MEM;
+    }
+    fs_struct->filemap[fd >> FILEMAP_CHUNK_SHIFT] = file;
+    int i;
+    for (fd = ROUNDDOWN_2N(fd, FILEMAP_CHUNK_SHIFT), i = 0; i < FILEMAP_CHUNK_NENTRY; i ++, fd ++, file ++) {
         atomic_set(&(file->open_count), 0);
         file->status = FD_NONE, file->fd = fd;
     }
+    return 0;
 }
 
 static int
 filemap_alloc(int fd, struct file **file_store) {
 //	panic("debug");
-    struct file *file = get_filemap();
+    struct fs_struct *fs_struct = get_fs_struct();
+    struct file *file;
+    int ret;
     if (fd == NO_FD) {
-        for (fd = 0; fd < FS_STRUCT_NENTRY; fd ++, file ++) {
+        for (fd = 0; fd < FS_STRUCT_NENTRY; fd ++) {
+            if ((file = filemap_get(fs_struct, fd)) == NULL) {
+                // every fd below is in use, open the chunk of this one
+                if ((ret = filemap_grow(fs_struct, fd)) != 0) {
+                    return ret;
+                }
+                file = filemap_get(fs_struct, fd);
+                goto found;
+            }
             if (file->status == FD_NONE) {
                 goto found;
             }
@@ -45,7 +64,12 @@ filemap_alloc(int fd, struct file **file_store) {
     }
     else {
         if (testfd(fd)) {
-            file += fd;
+            if ((file = filemap_get(fs_struct, fd)) == NULL) {
+                if ((ret = filemap_grow(fs_struct, fd)) != 0) {
+                    return ret;
+                }
+                file = filemap_get(fs_struct, fd);
+            }
             if (file->status == FD_NONE) {
                 goto found;
             }
@@ -118,8 +142,8 @@ filemap_dup(struct file *to, struct file *from) {
 static inline int
 fd2file(int fd, struct file **file_store) {
     if (testfd(fd)) {
-        struct file *file = get_filemap() + fd;
-        if (file->status == FD_OPENED && file->fd == fd) {
+        struct file *file = filemap_get(get_fs_struct(), fd);
+        if (file != NULL && file->status == FD_OPENED && file->fd == fd) {
             *file_store = file;
             return 0;
         }
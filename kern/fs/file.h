@@ -23,7 +23,7 @@ struct file {
     atomic_t open_count; // 打开此文件的次数
 };
 
-void filemap_init(struct file *filemap);
+int filemap_grow(struct fs_struct *fs_struct, int fd);
 void filemap_open(struct file *file);
 void filemap_close(struct file *file);
 void filemap_dup(struct file *to, struct file *from);
@@ -41,6 +41,13 @@ int file_dup(int fd1, int fd2);
 int file_pipe(int fd[]);
 int file_mkfifo(const char *name, uint32_t open_flags);
 
+// filemap_get - the file of fd in fs_struct, NULL if the chunk holding fd is not allocated
+static inline struct file *
+filemap_get(struct fs_struct *fs_struct, int fd) {
+    struct file *chunk = fs_struct->filemap[fd >> FILEMAP_CHUNK_SHIFT];
+    return (chunk != NULL) ? chunk + (fd & (FILEMAP_CHUNK_NENTRY - 1)) : NULL;
+}
+
 static inline int
 fopen_count(struct file *file) {
     return atomic_read(&(file->open_count));
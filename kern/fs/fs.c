@@ -1,6 +1,7 @@
 /*文件系统*/
 #include <defs.h>
 #include <kmalloc.h>
+#include <string.h>
 #include <sem.h>
 #include <vfs.h>
 #include <dev.h>
@@ -8,6 +9,7 @@
 #include <sfs.h>
 #include <inode.h>
 #include <assert.h>
+#include <error.h>
 
 //called when init_main proc start
 void
@@ -40,12 +42,16 @@ fs_create(void) {
 	//kprintf("[fs_create]\n");
     static_assert((int)FS_STRUCT_NENTRY > 128);
     struct fs_struct *fs_struct;
-    if ((fs_struct = kmalloc(sizeof(struct fs_struct) + FS_STRUCT_BUFSIZE)) != NULL) {
+    if ((fs_struct = kmalloc(sizeof(struct fs_struct))) != NULL) {
         fs_struct->pwd = NULL;
-        fs_struct->filemap = (void *)(fs_struct + 1);
+        memset(fs_struct->filemap, 0, sizeof(fs_struct->filemap));
         atomic_set(&(fs_struct->fs_count), 0);
         sem_init(&(fs_struct->fs_sem), 1);
-        filemap_init(fs_struct->filemap);
+        // the first chunk holds stdin & stdout, every process needs it
+        if (filemap_grow(fs_struct, 0) != 0) {
+            kfree(fs_struct);
+            return NULL;
+        }
     }
     return fs_struct;
 }
@@ -57,14 +63,23 @@ fs_destroy(struct fs_struct *fs_struct) {
     if (fs_struct->pwd != NULL) {
         vop_ref_dec(fs_struct->pwd);
     }
-    int i;
-    struct file *file = fs_struct->filemap;
-    for (i = 0; i < FS_STRUCT_NENTRY; i ++, file ++) {
+    int fd;
+    struct file *file;
+    for (fd = 0; fd < FS_STRUCT_NENTRY; fd ++) {
+        if ((file = filemap_get(fs_struct, fd)) == NULL) {
+            continue ;
+        }
         if (file->status == FD_OPENED) {
             filemap_close(file);
         }
         assert(file->status == FD_NONE);
     }
+    int i;
+    for (i = 0; i < FILEMAP_NCHUNK; i ++) {
+        if (fs_struct->filemap[i] != NULL) {
+            kfree(fs_struct->filemap[i]);
+        }
+    }
     kfree(fs_struct);
 }
 
@@ -72,11 +87,11 @@ void
 fs_closeall(struct fs_struct *fs_struct) {
 //	kprintf("[fs_closeall]\n");
     assert(fs_struct != NULL && fs_count(fs_struct) > 0);
-    int i;
-    struct file *file = fs_struct->filemap;
+    int fd;
+    struct file *file;
 	//skip the stdin & stdout
-    for (i = 2, file += 2; i < FS_STRUCT_NENTRY; i ++, file ++) {
-        if (file->status == FD_OPENED) {
+    for (fd = 2; fd < FS_STRUCT_NENTRY; fd ++) {
+        if ((file = filemap_get(fs_struct, fd)) != NULL && file->status == FD_OPENED) {
             filemap_close(file);
         }
     }
@@ -90,15 +105,54 @@ dup_fs(struct fs_struct *to, struct fs_struct *from) {
     if ((to->pwd = from->pwd) != NULL) {
         vop_ref_inc(to->pwd);
     }
-    int i;
-    struct file *to_file = to->filemap, *from_file = from->filemap;
-    for (i = 0; i < FS_STRUCT_NENTRY; i ++, to_file ++, from_file ++) {
-        if (from_file->status == FD_OPENED) {
-            /* alloc_fd first */
-            to_file->status = FD_INIT;
-            filemap_dup(to_file, from_file);
+    int fd, ret;
+    struct file *to_file, *from_file;
+    for (fd = 0; fd < FS_STRUCT_NENTRY; fd ++) {
+        if ((from_file = filemap_get(from, fd)) == NULL || from_file->status != FD_OPENED) {
+            continue ;
         }
+        if ((to_file = filemap_get(to, fd)) == NULL) {
+            // the caller destroys "to" on failure, which closes what has been dup'ed so far
+            if ((ret = filemap_grow(to, fd)) != 0) {
+                return ret;
+            }
+            to_file = filemap_get(to, fd);
+        }
+        /* alloc_fd first */
+        to_file->status = FD_INIT;
+        filemap_dup(to_file, from_file);
     }
     return 0;
 }
 
+/* *
+ * dup_fs_stdio - set up the fs_struct of a spawned process: the pwd of "from", and the
+ * files fd_in / fd_out of "from" as its fd 0 / 1. A negative fd leaves that one closed.
+ * */
+int
+dup_fs_stdio(struct fs_struct *to, struct fs_struct *from, int fd_in, int fd_out) {
+    assert(to != NULL && from != NULL);
+    assert(fs_count(to) == 0 && fs_count(from) > 0);
+    int fds[2] = {fd_in, fd_out}, fd;
+    struct file *to_file, *from_file[2] = {NULL, NULL};
+    for (fd = 0; fd < 2; fd ++) {
+        if (fds[fd] < 0) {
+            continue ;
+        }
+        if (fds[fd] >= FS_STRUCT_NENTRY || (from_file[fd] = filemap_get(from, fds[fd])) == NULL
+                || from_file[fd]->status != FD_OPENED) {
+            return -E_INVAL;
+        }
+    }
+    if ((to->pwd = from->pwd) != NULL) {
+        vop_ref_inc(to->pwd);
+    }
+    for (fd = 0; fd < 2; fd ++) {
+        if (from_file[fd] != NULL) {
+            to_file = filemap_get(to, fd);
+            to_file->status = FD_INIT;
+            filemap_dup(to_file, from_file[fd]);
+        }
+    }
+    return 0;
+}
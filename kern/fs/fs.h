@@ -19,16 +19,20 @@ void fs_cleanup(void);
 struct inode;
 struct file;
 
+// the file table grows in chunks of FILEMAP_CHUNK_NENTRY files, a chunk is only allocated once
+// one of its fds is used, so a process with a few open files pays for one chunk
+#define FILEMAP_CHUNK_SHIFT                     3
+#define FILEMAP_CHUNK_NENTRY                    (1 << FILEMAP_CHUNK_SHIFT)
+#define FILEMAP_NCHUNK                          20
+#define FS_STRUCT_NENTRY                        (FILEMAP_NCHUNK * FILEMAP_CHUNK_NENTRY)
+
 struct fs_struct {
     struct inode *pwd;
-    struct file *filemap;
+    struct file *filemap[FILEMAP_NCHUNK];       // filemap[i] holds fd i * FILEMAP_CHUNK_NENTRY and up, NULL if not allocated yet
     atomic_t fs_count;
     semaphore_t fs_sem;
 };
 
-#define FS_STRUCT_BUFSIZE                       (PGSIZE - sizeof(struct fs_struct))
-#define FS_STRUCT_NENTRY                        (FS_STRUCT_BUFSIZE / sizeof(struct file))
-
 void lock_fs(struct fs_struct *fs_struct);
 void unlock_fs(struct fs_struct *fs_struct);
 
@@ -36,6 +40,7 @@ struct fs_struct *fs_create(void);
 void fs_destroy(struct fs_struct *fs_struct);
 void fs_closeall(struct fs_struct *fs_struct);
 int dup_fs(struct fs_struct *to, struct fs_struct *from);
+int dup_fs_stdio(struct fs_struct *to, struct fs_struct *from, int fd_in, int fd_out);
 
 static inline int
 fs_count(struct fs_struct *fs_struct) {
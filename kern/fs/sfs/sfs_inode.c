@@ -12,6 +12,7 @@
 #include <bitmap.h>
 #include <error.h>
 #include <assert.h>
+#include <preempt.h>
 
 static const struct inode_ops sfs_node_dirops;
 static const struct inode_ops sfs_node_fileops;
@@ -517,6 +518,8 @@ sfs_io_nolock(struct sfs_fs *sfs, struct sfs_inode *sin, void *buf, off_t offset
     //读取中间部分的数据，将其分为size大学的块，然后一次读一块直至读完
     size = SFS_BLKSIZE;
     while(nblks != 0){
+        // 持有 sin->sem 不可抢占，长的读写在块之间主动让出 CPU
+        cond_resched();
         if((ret = sfs_bmap_load_nolock(sfs, sin, blkno, &ino)) != 0) {
             goto out;
         }
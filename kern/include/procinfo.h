@@ -0,0 +1,89 @@
+#ifndef __LIBS_PROCINFO_H__
+#define __LIBS_PROCINFO_H__
+
+#include <defs.h>
+
+/* *
+ * CPU time of a process: whole timer ticks, and the CP0 Count cycles of the tick in
+ * progress (always less than TIMER0_INTERVAL, see clock.h).
+ * */
+struct cputime {
+    uint32_t ticks;
+    uint32_t count;
+};
+
+// what the CPU time was spent on
+enum {
+    CPUTIME_USER,                       // running in user mode
+    CPUTIME_SYS,                        // in the kernel: syscalls, faults, the kernel threads
+    CPUTIME_IRQ,                        // in interrupt handlers
+    CPUTIME_NR,
+};
+
+#define PROCINFO_NAME_LEN   18
+
+// one process in the snapshot returned by SYS_procinfo
+struct procinfo {
+    int pid;
+    int ppid;                           // -1 for idle
+    uint32_t runs;                      // # of times picked by the scheduler
+    uint32_t nvcsw;                     // # of switches away while sleeping or exiting
+    uint32_t nivcsw;                    // # of switches away while still runnable
+    struct cputime times[CPUTIME_NR];
+    char state;                         // 'R' runnable, 'S' sleeping, 'Z' zombie, 'U' uninit
+    char name[PROCINFO_NAME_LEN + 1];
+};
+
+#define NICE_MIN            (-20)       // the most CPU
+#define NICE_MAX            19
+
+// scheduling policies, see SYS_sched_setscheduler
+#define SCHED_NORMAL        0           // the timesharing class, weighted by nice
+#define SCHED_FIFO          1           // real time, runs until it blocks or yields
+#define SCHED_RR            2           // real time, round robin within a priority
+#define RT_PRIO_MIN         1           // the real time priorities, the larger the more urgent
+#define RT_PRIO_MAX         32
+
+#define SCHEDLAT_NBUCKET    16          // latency buckets, bucket i: < 2^(i+10) CP0 Count cycles
+#define SCHEDLAT_MIN_SHIFT  10          // the upper bound of bucket 0 is 2^SCHEDLAT_MIN_SHIFT cycles
+#define RQLEN_NBUCKET       16          // run queue length buckets, bucket i: i runnable processes
+
+// why a process gave up the CPU, counted by schedule
+enum {
+    SWITCH_EXPIRED,                     // its time slice ran out in proc_tick
+    SWITCH_PREEMPTED,                   // still runnable otherwise: preempted by a wakeup, or yielded
+    SWITCH_BLOCKED,                     // it went to sleep or exited
+    SWITCH_NR,
+};
+
+// the scheduler's view of one process, returned by SYS_schedstat
+struct schedstat {
+    int pid;
+    int nice;
+    int policy;                         // SCHED_*
+    int rt_priority;                    // RT_PRIO_MIN..RT_PRIO_MAX - 1, 0 for SCHED_NORMAL
+    uint32_t vruntime;                  // virtual runtime in fair_sched_class
+    uint32_t nr_wakeups;                // # of times woken up
+    struct cputime run_delay;           // time spent runnable, waiting for the CPU
+    uint32_t max_delay;                 // the longest such wait, in CP0 Count cycles
+    uint32_t min_vruntime;              // the run queue's fair_min_vruntime
+    uint32_t max_wakeup;                // the longest wait from wakeup_proc to running, in cycles
+    uint32_t wakeup_hist[SCHEDLAT_NBUCKET];
+    uint32_t nr_switch[SWITCH_NR];      // # of calls to schedule, by SWITCH_*
+};
+
+// the system wide scheduler latencies, returned by SYS_schedlat
+struct schedlat {
+    uint32_t wakeup_hist[SCHEDLAT_NBUCKET]; // from wakeup_proc to running, every process
+    uint32_t wait_hist[SCHEDLAT_NBUCKET];   // every wait on the run queue, the preempted ones too
+    uint32_t max_wakeup;                // the longest wakeup latency, in CP0 Count cycles
+    int max_wakeup_pid;                 // the process that waited so long
+    uint32_t rqlen_hist[RQLEN_NBUCKET]; // ticks with i processes runnable, the running one included
+    uint32_t max_rqlen;
+    uint32_t nr_switch[SWITCH_NR];
+};
+
+#define SCHEDLAT_RESET      1           // SYS_schedlat flag: start over once copied
+
+#endif /* !__LIBS_PROCINFO_H__ */
+
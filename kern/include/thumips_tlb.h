@@ -64,14 +64,47 @@ static inline uint32_t pte2tlblow(pte_t pte)
   return t;
 }
 
+/* index of the tlb entry mapping the page pair of hi, negative (P bit) if none */
+static inline int tlb_probe_index(unsigned int hi)
+{
+  write_c0_entryhi(hi);
+  __asm__ __volatile__(
+      ".set noreorder\n\t"
+      ".set mips32r2\n\t"
+      "ehb\n\t"
+      ".set mips0\n\t"
+      ".set reorder");
+  tlb_probe();
+  __asm__ __volatile__(
+      ".set noreorder\n\t"
+      ".set mips32r2\n\t"
+      "ehb\n\t"
+      ".set mips0\n\t"
+      ".set reorder");
+  return (int)read_c0_index();
+}
+
 static inline void tlb_refill(uint32_t badaddr, pte_t *pte)
 {
   if(!pte)
     return ;
-  if(badaddr & (1<<12))
+  int odd = (badaddr & (1<<12)) != 0;
+  if(odd)
     pte--;
-  tlb_replace_random(0, badaddr & THUMIPS_TLB_ENTRYH_VPN2_MASK, 
-      pte2tlblow(*pte), pte2tlblow(*(pte+1)));
+  uint32_t lo0 = pte2tlblow(*pte), lo1 = pte2tlblow(*(pte+1));
+  /* the other page of the pair stays invalid while it is an untouched
+   * fault-around page, so that its first access is seen by handle_tlbmiss */
+  if(odd && (*pte & PTE_FA))
+    lo0 = 0;
+  if(!odd && (*(pte+1) & PTE_FA))
+    lo1 = 0;
+  /* the pair may already be in the tlb with that half invalid, replace it in place */
+  unsigned int hi = badaddr & THUMIPS_TLB_ENTRYH_VPN2_MASK;
+  int index = tlb_probe_index(hi);
+  if(index >= 0)
+    write_one_tlb(index, 0, hi, lo0, lo1);
+  else
+    tlb_replace_random(0, hi, lo0, lo1);
 }
 
 void tlb_invalidate_all();
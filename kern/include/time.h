@@ -0,0 +1,19 @@
+#ifndef __LIBS_TIME_H__
+#define __LIBS_TIME_H__
+
+#include <defs.h>
+
+#define NSEC_PER_SEC        1000000000
+#define NSEC_PER_USEC       1000
+
+// clocks of SYS_clock_gettime; there is no RTC, so both count from boot
+#define CLOCK_REALTIME      0
+#define CLOCK_MONOTONIC     1
+
+struct timespec {
+    uint32_t tv_sec;
+    uint32_t tv_nsec;                   // 0..NSEC_PER_SEC - 1
+};
+
+#endif /* !__LIBS_TIME_H__ */
+
@@ -10,9 +10,17 @@
 #define SYS_wait            3
 #define SYS_exec            4
 #define SYS_clone           5
+#define SYS_spawn           6
+#define SYS_exit_thread     7
+#define SYS_futex           8
+#define SYS_ras             9
 #define SYS_yield           10
 #define SYS_sleep           11
 #define SYS_kill            12
+#define SYS_nice            13
+#define SYS_sched_setscheduler 14
+#define SYS_nanosleep       15
+#define SYS_clock_gettime   16
 #define SYS_gettime         17
 #define SYS_getpid          18
 #define SYS_mmap            20
@@ -20,6 +28,11 @@
 #define SYS_shmem           22
 #define SYS_putc            30
 #define SYS_pgdir           31
+#define SYS_allocprof       32
+#define SYS_procinfo        33
+#define SYS_schedstat       34
+#define SYS_irqsoff         35
+#define SYS_schedlat        36
 #define SYS_open            100
 #define SYS_close           101
 #define SYS_read            102
@@ -33,7 +46,20 @@
 /* OLNY FOR LAB6 */
 #define SYS_lab6_set_priority 255
 
-/* SYS_fork flags */
+/* SYS_allocprof ops */
+#define ALLOCPROF_PRINT     0           // print the allocations by call site
+#define ALLOCPROF_RESET     1           // restart peaks and allocation counts from now
+
+/* SYS_irqsoff ops */
+#define IRQSOFF_PRINT       0           // print the longest interrupts-off window and the histogram
+#define IRQSOFF_RESET       1           // forget the windows seen so far
+
+/* SYS_futex ops */
+#define FUTEX_WAIT          0           // sleep while *uaddr == val
+#define FUTEX_WAKE          1           // wake at most val waiters of uaddr
+#define FUTEX_CMPXCHG       2           // if *uaddr == val, set it to val2; return the old value
+
+/* SYS_fork / SYS_clone flags */
 #define CLONE_VM            0x00000100  // set if VM shared between processes
 #define CLONE_THREAD        0x00000200  // thread group
 #define CLONE_FS            0x00000800  // set if shared between processes
@@ -64,6 +90,7 @@
 
 #define EXEC_MAX_ARG_NUM    32
 #define EXEC_MAX_ARG_LEN    4095
+#define EXEC_MAX_ARGS_SIZE  32768       // the argv strings together, they are packed on the user stack
 
 #endif /* !__LIBS_UNISTD_H__ */
 
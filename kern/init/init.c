@@ -12,6 +12,10 @@
 #include <proc.h>
 #include <thumips_tlb.h>
 #include <sched.h>
+#include <zswap.h>
+#include <ksm.h>
+#include <futex.h>
+#include <softirq.h>
 
 void setup_exception_vector()
 {
@@ -49,8 +53,12 @@ kern_init(void) {
     pmm_init();                 // init physical memory management
 
     vmm_init();                 // init virtual memory management
+    zswap_init();               // init compressed swap in memory
+    ksm_init();                 // init same-page merging
+    softirq_init();             // init interrupt bottom halves
     sched_init();
     proc_init();                // init process table
+    futex_init();               // init futex wait queues
 
     ide_init();
     fs_init();
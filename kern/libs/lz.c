@@ -0,0 +1,139 @@
+#include <defs.h>
+#include <lz.h>
+
+/* *
+ * A small LZ77 compressor in the spirit of LZJB/LZRW1, used to pack cold
+ * anonymous pages in memory (see kern/mm/zswap.c).
+ *
+ * The output is a sequence of groups. Each group starts with a control byte
+ * whose bits, from the lowest one, tell whether the next item is a literal
+ * byte (0) or a match (1). A match is two bytes:
+ *
+ *   +----6----+----10----+
+ *   | len - 3 | dist - 1 |
+ *   +---------+----------+
+ *
+ * so matches are 3~66 bytes long and reach back up to 1024 bytes.
+ *
+ * The compressor keeps one candidate per hash bucket. Buckets are never cleared
+ * between calls: a stale pointer is either outside the current input and
+ * rejected, or inside it and checked byte by byte, so it can only cost a
+ * missed match, never a wrong one.
+ * */
+
+#define LZ_MIN_MATCH        3
+#define LZ_MAX_MATCH        (LZ_MIN_MATCH + 0x3F)
+#define LZ_MAX_DIST         (1 << 10)
+#define LZ_HASH_SHIFT       10
+#define LZ_HASH_SIZE        (1 << LZ_HASH_SHIFT)
+
+static const uint8_t *lz_hash_table[LZ_HASH_SIZE];
+
+// lz_hash - fold the 24 bits of p[0..2] into LZ_HASH_SHIFT bits; shifts and xors only, the
+//         - CPU has no multiply and this runs at every input position
+static inline uint32_t
+lz_hash(const uint8_t *p) {
+    uint32_t v = ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+    return (v ^ (v >> 7) ^ (v >> 14)) & (LZ_HASH_SIZE - 1);
+}
+
+/* *
+ * lz_compress - compress @len bytes at @src into @dst
+ * @maxlen:     the size of @dst
+ *
+ * Returns the compressed length, or 0 if the result would not fit in @maxlen
+ * (the caller then treats the data as incompressible).
+ * */
+size_t
+lz_compress(const void *src, size_t len, void *dst, size_t maxlen) {
+    const uint8_t *in = src, *ip = in, *end = in + len;
+    uint8_t *op = dst, *oend = op + maxlen, *ctrl = NULL;
+    int bit = 8;
+
+    while (ip < end) {
+        if (bit == 8) {
+            if (op >= oend) {
+                return 0;
+            }
+            ctrl = op ++, *ctrl = 0, bit = 0;
+        }
+        const uint8_t *ref = NULL;
+        size_t mlen = 0;
+        if (end - ip >= LZ_MIN_MATCH) {
+            const uint8_t **slot = lz_hash_table + lz_hash(ip);
+            ref = *slot, *slot = ip;
+            if (ref >= in && ref < ip && ip - ref <= LZ_MAX_DIST) {
+                size_t limit = end - ip;
+                if (limit > LZ_MAX_MATCH) {
+                    limit = LZ_MAX_MATCH;
+                }
+                while (mlen < limit && ref[mlen] == ip[mlen]) {
+                    mlen ++;
+                }
+            }
+        }
+        if (mlen >= LZ_MIN_MATCH) {
+            if (oend - op < 2) {
+                return 0;
+            }
+            uint32_t code = ((mlen - LZ_MIN_MATCH) << 10) | (ip - ref - 1);
+            *op ++ = code >> 8;
+            *op ++ = code & 0xFF;
+            *ctrl |= (1 << bit);
+            ip += mlen;
+        }
+        else {
+            if (op >= oend) {
+                return 0;
+            }
+            *op ++ = *ip ++;
+        }
+        bit ++;
+    }
+    return op - (uint8_t *)dst;
+}
+
+/* *
+ * lz_decompress - expand @len bytes of lz_compress output at @src into @dst
+ * @maxlen:     the size of @dst
+ *
+ * Returns the expanded length, or 0 if the input is corrupted.
+ * */
+size_t
+lz_decompress(const void *src, size_t len, void *dst, size_t maxlen) {
+    const uint8_t *ip = src, *end = ip + len;
+    uint8_t *out = dst, *op = out, *oend = out + maxlen;
+    uint32_t ctrl = 0;
+    int bit = 8;
+
+    while (ip < end) {
+        if (bit == 8) {
+            ctrl = *ip ++, bit = 0;
+            continue ;
+        }
+        if (ctrl & (1 << bit)) {
+            if (end - ip < 2) {
+                return 0;
+            }
+            uint32_t code = ((uint32_t)ip[0] << 8) | ip[1];
+            size_t mlen = (code >> 10) + LZ_MIN_MATCH, dist = (code & (LZ_MAX_DIST - 1)) + 1;
+            const uint8_t *ref = op - dist;
+            ip += 2;
+            if (ref < out || oend - op < mlen) {
+                return 0;
+            }
+            while (mlen -- > 0) {
+                *op ++ = *ref ++;
+            }
+        }
+        else {
+            if (op >= oend) {
+                return 0;
+            }
+            *op ++ = *ip ++;
+        }
+        bit ++;
+    }
+    return op - out;
+}
+
@@ -0,0 +1,11 @@
+#ifndef __LIBS_LZ_H__
+#define __LIBS_LZ_H__
+
+#include <defs.h>
+
+/* libs/lz.c */
+size_t lz_compress(const void *src, size_t len, void *dst, size_t maxlen);
+size_t lz_decompress(const void *src, size_t len, void *dst, size_t maxlen);
+
+#endif /* !__LIBS_LZ_H__ */
+
@@ -0,0 +1,253 @@
+// 分配调用点统计（alloc_prof）：按调用者的返回地址统计 kmalloc 与 alloc_pages 占用的内存
+#include <defs.h>
+#include <sync.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <pmm.h>
+#include <alloc_prof.h>
+
+#if ALLOC_PROF
+
+/* Every allocation is charged to a call site: the return address of the kmalloc,
+   alloc_pages, alloc_pages_flags or pgdir_alloc_page* call, together with the kind of
+   memory. sites[] is an open hash of the call sites that never shrinks; sites[0] is
+   "(other)", it takes every call site that finds the table full.
+
+   A page remembers its site in page_site[ppn] (site + 1, 0 if not charged). A page that
+   is handed on, e.g. taken from the zero pool, moves to the new site. A kmalloc'ed object
+   is found in obj_hash; when all ALLOC_PROF_NOBJ nodes are used the object is counted in
+   nr_dropped and not charged at all.
+
+   The tables are static, so the profiler never allocates and the leak checks in init_main
+   do not see it. It costs about 90KB of BSS when ALLOC_PROF is 1, and nothing when 0. */
+
+enum {
+    PROF_OTHER, PROF_KMALLOC, PROF_PAGES,
+};
+
+static const char *prof_kind_name[] = {
+    [PROF_OTHER]    "other",
+    [PROF_KMALLOC]  "kmalloc",
+    [PROF_PAGES]    "pages",
+};
+
+struct alloc_site {
+    uintptr_t caller;           // the return address of the call, 0 if the slot is unused
+    int kind;                   // PROF_*
+    size_t live;                // # of bytes allocated and not freed yet
+    size_t peak;                // the max of live since the last reset
+    size_t nr_allocs;           // # of allocations since the last reset
+};
+
+struct obj_node {
+    void *obj;
+    struct obj_node *next;      // next node in the same hash chain, or in obj_free
+};
+
+static struct alloc_site sites[ALLOC_PROF_NSITE];
+static uint8_t page_site[KMEMSIZE / PGSIZE];
+
+static struct obj_node obj_nodes[ALLOC_PROF_NOBJ];
+static uint8_t obj_site[ALLOC_PROF_NOBJ];
+static struct obj_node *obj_hash[1 << ALLOC_PROF_HASH_SHIFT];
+static struct obj_node *obj_free;   // nodes released by kfree
+static size_t obj_top;              // obj_nodes[obj_top...] have never been used
+static size_t nr_dropped;
+
+#define obj_hashfn(obj)             (obj_hash + hash32((uintptr_t)(obj), ALLOC_PROF_HASH_SHIFT))
+
+// site_get - the site of (kind, caller), add it if it is new; 0 if the table is full
+static int
+site_get(int kind, uintptr_t caller) {
+    int i = hash32(caller ^ kind, ALLOC_PROF_NSITE_SHIFT), n;
+    for (n = 0; n < ALLOC_PROF_NSITE; n ++, i = (i + 1) & (ALLOC_PROF_NSITE - 1)) {
+        struct alloc_site *site = sites + i;
+        if (i == 0) {
+            continue ;
+        }
+        if (site->caller == caller && site->kind == kind) {
+            return i;
+        }
+        if (site->caller == 0) {
+            site->caller = caller, site->kind = kind;
+            return i;
+        }
+    }
+    return 0;
+}
+
+static inline void
+site_charge(int i, size_t size) {
+    struct alloc_site *site = sites + i;
+    if ((site->live += size) > site->peak) {
+        site->peak = site->live;
+    }
+}
+
+void
+alloc_prof_kmalloc(void *objp, size_t size, uintptr_t caller) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        int i = site_get(PROF_KMALLOC, caller);
+        sites[i].nr_allocs ++;
+
+        struct obj_node *node;
+        if ((node = obj_free) != NULL) {
+            obj_free = node->next;
+        }
+        else if (obj_top < ALLOC_PROF_NOBJ) {
+            node = obj_nodes + obj_top ++;
+        }
+        if (node != NULL) {
+            struct obj_node **head = obj_hashfn(objp);
+            node->obj = objp, node->next = *head, *head = node;
+            obj_site[node - obj_nodes] = i;
+            site_charge(i, size);
+        }
+        else {
+            nr_dropped ++;
+        }
+    }
+    local_intr_restore(intr_flag);
+}
+
+void
+alloc_prof_kfree(void *objp, size_t size) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        struct obj_node **link = obj_hashfn(objp), *node;
+        while ((node = *link) != NULL) {
+            if (node->obj == objp) {
+                *link = node->next;
+                sites[obj_site[node - obj_nodes]].live -= size;
+                node->next = obj_free, obj_free = node;
+                break;
+            }
+            link = &(node->next);
+        }
+    }
+    local_intr_restore(intr_flag);
+}
+
+void
+alloc_prof_pages(struct Page *page, size_t n, uintptr_t caller) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        int i = site_get(PROF_PAGES, caller);
+        uint8_t *ps = page_site + page2ppn(page);
+        size_t k;
+        for (k = 0; k < n; k ++) {
+            if (ps[k] != 0) {
+                sites[ps[k] - 1].live -= PGSIZE;
+            }
+            ps[k] = i + 1;
+        }
+        sites[i].nr_allocs ++;
+        site_charge(i, n * PGSIZE);
+    }
+    local_intr_restore(intr_flag);
+}
+
+void
+alloc_prof_free_pages(struct Page *base, size_t n) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        uint8_t *ps = page_site + page2ppn(base);
+        size_t k;
+        for (k = 0; k < n; k ++) {
+            if (ps[k] != 0) {
+                sites[ps[k] - 1].live -= PGSIZE;
+                ps[k] = 0;
+            }
+        }
+    }
+    local_intr_restore(intr_flag);
+}
+
+//alloc_prof_reset - restart the peaks and the allocation counts from now, live bytes are kept
+void
+alloc_prof_reset(void) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        int i;
+        for (i = 0; i < ALLOC_PROF_NSITE; i ++) {
+            sites[i].peak = sites[i].live;
+            sites[i].nr_allocs = 0;
+        }
+        nr_dropped = 0;
+    }
+    local_intr_restore(intr_flag);
+}
+
+/* *
+ * alloc_prof_print - print the call sites, most live bytes first. The callers are return
+ * addresses, tools/allocprof.sh turns them into functions and lines with the kernel ELF.
+ * */
+void
+alloc_prof_print(void) {
+    static_assert(ALLOC_PROF_NSITE <= 255);
+    char printed[ALLOC_PROF_NSITE];
+    size_t total[3] = {0};
+    int i, n;
+    for (i = 0; i < ALLOC_PROF_NSITE; i ++) {
+        printed[i] = 0;
+        total[sites[i].kind] += sites[i].live;
+    }
+    kprintf("allocprof: kind caller live peak allocs\n");
+    for (n = 0; n < ALLOC_PROF_NSITE; n ++) {
+        int max = -1;
+        for (i = 0; i < ALLOC_PROF_NSITE; i ++) {
+            if (!printed[i] && (sites[i].caller != 0 || i == 0)
+                    && (max < 0 || sites[i].live > sites[max].live)) {
+                max = i;
+            }
+        }
+        if (max < 0) {
+            break;
+        }
+        printed[max] = 1;
+        struct alloc_site *site = sites + max;
+        if (site->live != 0 || site->nr_allocs != 0) {
+            kprintf("  %-8s %08x %9d %9d %7d\n", prof_kind_name[site->kind], site->caller,
+                    site->live, site->peak, site->nr_allocs);
+        }
+    }
+    kprintf("allocprof: live kmalloc %d, pages %d, other %d bytes; %d kmalloc objects not tracked.\n",
+            total[PROF_KMALLOC], total[PROF_PAGES], total[PROF_OTHER], nr_dropped);
+}
+
+#else /* !ALLOC_PROF */
+
+void
+alloc_prof_kmalloc(void *objp, size_t size, uintptr_t caller) {
+}
+
+void
+alloc_prof_kfree(void *objp, size_t size) {
+}
+
+void
+alloc_prof_pages(struct Page *page, size_t n, uintptr_t caller) {
+}
+
+void
+alloc_prof_free_pages(struct Page *base, size_t n) {
+}
+
+void
+alloc_prof_reset(void) {
+}
+
+void
+alloc_prof_print(void) {
+    kprintf("allocprof: not built in, set ALLOC_PROF in kern/mm/alloc_prof.h.\n");
+}
+
+#endif /* ALLOC_PROF */
+
@@ -0,0 +1,25 @@
+// 分配调用点统计（alloc_prof）的接口定义
+#ifndef __KERN_MM_ALLOC_PROF_H__
+#define __KERN_MM_ALLOC_PROF_H__
+
+#include <defs.h>
+#include <memlayout.h>
+
+#define ALLOC_PROF              0           // 1: charge every kmalloc / alloc_pages to its call site
+#define ALLOC_PROF_NSITE_SHIFT  7
+#define ALLOC_PROF_NSITE        (1 << ALLOC_PROF_NSITE_SHIFT)   // # of call sites, must fit in a uint8_t
+#define ALLOC_PROF_NOBJ         8192        // # of live kmalloc objects that can be tracked
+#define ALLOC_PROF_HASH_SHIFT   11
+
+// the return address of the current function, the call site an allocation is charged to
+#define ALLOC_CALLER()          ((uintptr_t)__builtin_return_address(0))
+
+void alloc_prof_kmalloc(void *objp, size_t size, uintptr_t caller);
+void alloc_prof_kfree(void *objp, size_t size);
+void alloc_prof_pages(struct Page *page, size_t n, uintptr_t caller);
+void alloc_prof_free_pages(struct Page *base, size_t n);
+void alloc_prof_reset(void);
+void alloc_prof_print(void);
+
+#endif /* !__KERN_MM_ALLOC_PROF_H__ */
+
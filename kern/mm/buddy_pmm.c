@@ -34,6 +34,48 @@ static free_area_t free_area[MAX_ORDER + 1];
 #define free_list(x) (free_area[x].free_list)
 #define nr_free(x) (free_area[x].nr_free)
 
+// free single pages are kept on one list per colour (see PAGE_COLOUR_SHIFT in pmm.h),
+// free_list(0) stays empty; nr_free(0) counts the pages of all colour lists
+static list_entry_t colour_area[NR_PAGE_COLOURS];
+#define colour_list(c) (colour_area[c])
+
+// single pages without a colour hint are taken from the colour lists in turn
+static size_t next_colour = 0;
+
+//free_list_of - the list a free block of 2^order pages starting at page belongs to
+static inline list_entry_t *
+free_list_of(struct Page *page, size_t order) {
+    return (order == 0) ? &colour_list(page_colour(page)) : &free_list(order);
+}
+
+//free_list_get - a non-empty list to take a 2^order block from, NULL if there is none
+//              - colour >= 0: the block must contain a page of this colour (order 0 requests only)
+static inline list_entry_t *
+free_list_get(size_t order, int colour) {
+    list_entry_t *list;
+    if (order == 0) {
+        if (colour >= 0) {
+            list = &colour_list(colour);
+            return list_empty(list) ? NULL : list;
+        }
+        int i;
+        for (i = 0; i < NR_PAGE_COLOURS; i ++) {
+            list = &colour_list(next_colour);
+            next_colour = (next_colour + 1) & (NR_PAGE_COLOURS - 1);
+            if (!list_empty(list)) {
+                return list;
+            }
+        }
+        return NULL;
+    }
+    // a block smaller than NR_PAGE_COLOURS pages holds only some of the colours, do not search them
+    if (colour >= 0 && (1 << order) < NR_PAGE_COLOURS) {
+        return NULL;
+    }
+    list = &free_list(order);
+    return list_empty(list) ? NULL : list;
+}
+
 #define MAX_ZONE_NUM 10
 struct Zone {
     struct Page *mem_base;
@@ -47,6 +89,9 @@ buddy_init(void) {
         list_init(&free_list(i));
         nr_free(i) = 0;
     }
+    for (i = 0; i < NR_PAGE_COLOURS; i ++) {
+        list_init(&colour_list(i));
+    }
 }
 
 //buddy_init_memmap - build free_list for Page base follow  n continuous pages.
@@ -67,7 +112,7 @@ buddy_init_memmap(struct Page *base, size_t n) {
         while (n >= order_size) {
             p->property = order;
             SetPageProperty(p);
-            list_add(&free_list(order), &(p->page_link));
+            list_add(free_list_of(p, order), &(p->page_link));
             n -= order_size, p += order_size;
             nr_free(order) ++;
         }
@@ -90,26 +135,34 @@ getorder(size_t n) {
 
 //buddy_alloc_pages_sub - the actual allocation implimentation, return a page whose size >=n,
 //                      - the remaining free parts insert to other free list
+//                      - colour >= 0: return a single page of this colour (order must be 0)
 // 实际的分配空间的算法啊，返回页并将剩余空间插入空闲空间列表
 static inline struct Page *
-buddy_alloc_pages_sub(size_t order) {
-    assert(order <= MAX_ORDER);
+buddy_alloc_pages_sub(size_t order, int colour) {
+    assert(order <= MAX_ORDER && (colour < 0 || order == 0));
     size_t cur_order;
     for (cur_order = order; cur_order <= MAX_ORDER; cur_order ++) {
-        if (!list_empty(&free_list(cur_order))) {
-            list_entry_t *le = list_next(&free_list(cur_order));
+        list_entry_t *list;
+        if ((list = free_list_get(cur_order, colour)) != NULL) {
+            list_entry_t *le = list_next(list);
             struct Page *page = le2page(le, page_link);  // Page结构中包含le，因此可以通过le的位置减去偏移得到Page结构的起始位置
             nr_free(cur_order) --;
             list_del(le);
             size_t size = 1 << cur_order;
+            // the block holds every colour, target is its first page of the wanted one
+            struct Page *target = page + ((colour - page_colour(page)) & (NR_PAGE_COLOURS - 1));
             while (cur_order > order) {
                 cur_order --;
                 size >>= 1;
                 struct Page *buddy = page + size;  // 下一个Page
+                // keep the half holding target, the other one goes back to the free lists
+                if (colour >= 0 && target >= buddy) {
+                    buddy = page, page += size;
+                }
                 buddy->property = cur_order;
                 SetPageProperty(buddy);
                 nr_free(cur_order) ++;
-                list_add(&free_list(cur_order), &(buddy->page_link));
+                list_add(free_list_of(buddy, cur_order), &(buddy->page_link));
             }
             ClearPageProperty(page);
             return page;
@@ -123,13 +176,20 @@ static struct Page *
 buddy_alloc_pages(size_t n) {
     assert(n > 0);
     size_t order = getorder(n), order_size = (1 << order);
-    struct Page *page = buddy_alloc_pages_sub(order);
+    struct Page *page = buddy_alloc_pages_sub(order, -1);
     if (page != NULL && n != order_size) {
         free_pages(page + n, order_size - n);
     }
     return page;
 }
 
+//buddy_alloc_page_colour - alloc a single page of colour, NULL if no free block holds one
+static struct Page *
+buddy_alloc_page_colour(size_t colour) {
+    assert(colour < NR_PAGE_COLOURS);
+    return buddy_alloc_pages_sub(0, colour);
+}
+
 //page_is_buddy - Does this page belong to the No. zone_num Zone & this page
 //              -  be in the continuous page block whose size is 2^order pages?
 static inline bool
@@ -183,7 +243,7 @@ buddy_free_pages_sub(struct Page *base, size_t order) {
     page->property = order;
     SetPageProperty(page);
     nr_free(order) ++;
-    list_add(&free_list(order), &(page->page_link));
+    list_add(free_list_of(page, order), &(page->page_link));
 }
 
 //buddy_free_pages - call buddy_free_pages_sub to free n continuous page block
@@ -227,19 +287,36 @@ buddy_nr_free_pages(void) {
     return ret;
 }
 
-//buddy_check - check the correctness of buddy system
-static void
-buddy_check(void) {
-    int i;
-    int count = 0, total = 0;
+//buddy_check_free_lists - check the blocks of every free list, return the # of free pages,
+//                       - the # of blocks is stored in *count_store
+static int
+buddy_check_free_lists(int *count_store) {
+    int i, count = 0, total = 0;
     for (i = 0; i <= MAX_ORDER; i ++) {
         list_entry_t *list = &free_list(i), *le = list;
         while ((le = list_next(le)) != list) {
             struct Page *p = le2page(le, page_link);
-            assert(PageProperty(p) && p->property == i);
+            assert(i != 0 && PageProperty(p) && p->property == i);
             count ++, total += (1 << i);
         }
     }
+    for (i = 0; i < NR_PAGE_COLOURS; i ++) {
+        list_entry_t *list = &colour_list(i), *le = list;
+        while ((le = list_next(le)) != list) {
+            struct Page *p = le2page(le, page_link);
+            assert(PageProperty(p) && p->property == 0 && page_colour(p) == i);
+            count ++, total ++;
+        }
+    }
+    *count_store = count;
+    return total;
+}
+
+//buddy_check - check the correctness of buddy system
+static void
+buddy_check(void) {
+    int i;
+    int count, total = buddy_check_free_lists(&count);
     assert(total == nr_free_pages());
 
     struct Page *p0 = alloc_pages(8), *buddy = alloc_pages(8), *p1;
@@ -248,7 +325,7 @@ buddy_check(void) {
     assert((page2idx(p0) & 7) == 0);
     assert(!PageProperty(p0));
 
-    list_entry_t free_lists_store[MAX_ORDER + 1];
+    list_entry_t free_lists_store[MAX_ORDER + 1], colour_lists_store[NR_PAGE_COLOURS];
     unsigned int nr_free_store[MAX_ORDER + 1];
 
     for (i = 0; i <= MAX_ORDER; i ++) {
@@ -258,6 +335,10 @@ buddy_check(void) {
         nr_free_store[i] = nr_free(i);
         nr_free(i) = 0;
     }
+    for (i = 0; i < NR_PAGE_COLOURS; i ++) {
+        colour_lists_store[i] = colour_list(i);
+        list_init(&colour_list(i));
+    }
 
     assert(nr_free_pages() == 0);
     assert(alloc_page() == NULL);
@@ -288,6 +369,19 @@ buddy_check(void) {
     free_pages(p0, 4);
     assert(PageProperty(p0) && p0->property == 3);
 
+    // every colour can be cut out of the 8-page block, and the pieces merge again
+    static_assert(NR_PAGE_COLOURS <= 8);
+    struct Page *pc[NR_PAGE_COLOURS];
+    for (i = 0; i < NR_PAGE_COLOURS; i ++) {
+        assert((pc[i] = buddy_alloc_page_colour(i)) != NULL && page_colour(pc[i]) == i);
+        assert(pc[i] >= p0 && pc[i] < p0 + 8);
+    }
+    for (i = 0; i < NR_PAGE_COLOURS; i ++) {
+        free_page(pc[i]);
+    }
+    assert(nr_free_pages() == 8);
+    assert(PageProperty(p0) && p0->property == 3);
+
     assert((p0 = alloc_pages(8)) != NULL);
     assert(alloc_page() == NULL && nr_free_pages() == 0);
 
@@ -295,22 +389,18 @@ buddy_check(void) {
         free_list(i) = free_lists_store[i];
         nr_free(i) = nr_free_store[i];
     }
+    for (i = 0; i < NR_PAGE_COLOURS; i ++) {
+        colour_list(i) = colour_lists_store[i];
+    }
 
     free_pages(p0, 8);
     free_pages(buddy, 8);
 
     assert(total == nr_free_pages());
 
-    for (i = 0; i <= MAX_ORDER; i ++) {
-        list_entry_t *list = &free_list(i), *le = list;
-        while ((le = list_next(le)) != list) {
-            struct Page *p = le2page(le, page_link);
-            assert(PageProperty(p) && p->property == i);
-            count --, total -= (1 << i);
-        }
-    }
-    assert(count == 0);
-    assert(total == 0);
+    int count_after;
+    assert(buddy_check_free_lists(&count_after) == total);
+    assert(count_after == count);
 }
 
 //the buddy system pmm
@@ -319,6 +409,7 @@ const struct pmm_manager buddy_pmm_manager = {
     .init = buddy_init,
     .init_memmap = buddy_init_memmap,
     .alloc_pages = buddy_alloc_pages,
+    .alloc_page_colour = buddy_alloc_page_colour,
     .free_pages = buddy_free_pages,
     .nr_free_pages = buddy_nr_free_pages,
     .check = buddy_check,
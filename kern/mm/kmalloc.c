@@ -8,6 +8,7 @@
 #include <pmm.h>
 #include <stdio.h>
 #include <rb_tree.h>
+#include <alloc_prof.h>
 
 /* IMPORTANT: Do NOT modify any constants in this file!!! (FOR thumips) */
 
@@ -416,7 +417,19 @@ kmalloc(size_t size) {
     if (order > MAX_SIZE_ORDER) {
         return NULL;
     }
-    return kmem_cache_alloc(slab_cache + (order - MIN_SIZE_ORDER));
+    kmem_cache_t *cachep = slab_cache + (order - MIN_SIZE_ORDER);
+    void *objp = kmem_cache_alloc(cachep);
+    if (ALLOC_PROF && objp != NULL) {
+        alloc_prof_kmalloc(objp, cachep->objsize, ALLOC_CALLER());
+    }
+    return objp;
+}
+
+// kmalloc_size - the size of the object kmalloc(size) really hands out
+size_t
+kmalloc_size(size_t size) {
+    assert(size > 0);
+    return 1 << getorder(size);
 }
 
 static void kmem_cache_free(kmem_cache_t *cachep, void *obj);
@@ -487,7 +500,11 @@ kmem_cache_free(kmem_cache_t *cachep, void *objp) {
 // kfree - simple interface used by ooutside functions to free an obj
 void
 kfree(void *objp) {
-    kmem_cache_free(GET_PAGE_CACHE(kva2page(objp)), objp);
+    kmem_cache_t *cachep = GET_PAGE_CACHE(kva2page(objp));
+    if (ALLOC_PROF) {
+        alloc_prof_kfree(objp, cachep->objsize);
+    }
+    kmem_cache_free(cachep, objp);
 }
 
 static inline void
@@ -9,6 +9,7 @@ void kmalloc_init(void);
 
 void *kmalloc(size_t n);
 void kfree(void *objp);
+size_t kmalloc_size(size_t n);
 
 size_t kallocated(void);
 
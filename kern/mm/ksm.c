@@ -0,0 +1,392 @@
+// 相同页合并（ksm）：空闲时扫描用户页，把内容相同的私有页合并为一个只读共享页，写时再复制
+#include <defs.h>
+#include <list.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <error.h>
+#include <rb_tree.h>
+#include <kmalloc.h>
+#include <clock.h>
+#include <pmm.h>
+#include <vmm.h>
+#include <proc.h>
+#include <thumips_tlb.h>
+#include <rmap.h>
+#include <ksm.h>
+
+/* Every process loads its own private copy of its program, and a lot of anonymous memory
+   is never written after it is faulted in, so several user pages often hold the same bytes.
+   ksm finds them and keeps a single copy.
+
+   idleproc calls ksm_scan from cpu_idle. Each call hashes at most KSM_PAGES_TO_SCAN private
+   user pages (page_ref == 1) and resumes where the previous call stopped (ksm_cursor), so a
+   full round over all processes is spread over many ticks.
+
+   A page whose content matches a page of the stable tree is remapped to the stable page and
+   freed. Otherwise its (pid, la) is remembered in the candidate table, one slot per hash
+   bucket; when a second page with the same content shows up, the candidate is turned into a
+   stable page and the second page is merged into it. The candidate table is forgotten at
+   the end of each round, a candidate is looked up again through find_proc and get_pte
+   before it is used, and two pages are only merged after a full memcmp, so a stale or
+   colliding entry can cost a missed merge but never a wrong one.
+
+   Stable pages are mapped without PTE_W and marked PG_ksm. Their content cannot change, so
+   the stable tree is ordered by (checksum, content). A write from a writable vma faults and
+   do_pgfault calls ksm_break_cow, which gives the writer a private copy, or gives the page
+   itself back when it is mapped only once. The tree holds no reference on its pages: the
+   node of a stable page is dropped when its last mapping goes away (ksm_page_release).
+*/
+
+struct ksm_node {
+    uint32_t sum;               // checksum of the page
+    struct Page *page;          // the merged page
+    rb_node rb_link;            // link in ksm_stable
+};
+
+#define rbn2ksm(node)           (to_struct(node, struct ksm_node, rb_link))
+
+struct ksm_key {
+    uint32_t sum;
+    void *kva;
+};
+
+struct ksm_item {
+    int pid;                    // the candidate page is mapped at la in the mm of proc pid
+    uintptr_t la;
+    struct Page *page;          // NULL if the slot is empty
+    uint32_t sum;
+};
+
+static rb_tree *ksm_stable;
+static struct ksm_item ksm_unstable[1 << KSM_UNSTABLE_SHIFT];
+static bool ksm_init_ok = 0;
+
+static struct {
+    int pid;                    // process being scanned, 0 for the head of proc_list
+    uintptr_t la;               // next address to scan in it
+    size_t tick;                // ticks of the last batch
+} ksm_cursor;
+
+static struct {
+    size_t nr_stable;           // # of pages in the stable tree
+    size_t nr_merged;           // pages freed by merging
+    size_t nr_cow;              // write faults on merged pages
+    size_t nr_full_scans;       // # of rounds over all processes
+} ksm_stat;
+
+static void check_ksm(void);
+
+//ksm_checksum - FNV-1a over the words of a page; the CPU has no multiply, so the FNV prime
+//             - 2^24 + 2^8 + 0x93 is applied as shifts and adds
+static uint32_t
+ksm_checksum(void *kva) {
+    uint32_t *p = kva, sum = 2166136261U;
+    int i;
+    for (i = 0; i < PGSIZE / sizeof(uint32_t); i ++) {
+        sum ^= p[i];
+        sum += (sum << 1) + (sum << 4) + (sum << 7) + (sum << 8) + (sum << 24);
+    }
+    return sum;
+}
+
+static int
+ksm_compare_content(uint32_t sum1, void *kva1, uint32_t sum2, void *kva2) {
+    if (sum1 != sum2) {
+        return (sum1 < sum2) ? -1 : 1;
+    }
+    return memcmp(kva1, kva2, PGSIZE);
+}
+
+static int
+ksm_compare(rb_node *node1, rb_node *node2) {
+    struct ksm_node *kn1 = rbn2ksm(node1), *kn2 = rbn2ksm(node2);
+    return ksm_compare_content(kn1->sum, page2kva(kn1->page), kn2->sum, page2kva(kn2->page));
+}
+
+static int
+ksm_compare_key(rb_node *node, void *key) {
+    struct ksm_node *kn = rbn2ksm(node);
+    struct ksm_key *k = key;
+    return ksm_compare_content(kn->sum, page2kva(kn->page), k->sum, k->kva);
+}
+
+//ksm_stable_lookup - find the stable page holding the PGSIZE bytes at kva
+static struct Page *
+ksm_stable_lookup(uint32_t sum, void *kva) {
+    struct ksm_key key = {sum, kva};
+    rb_node *node = rb_search(ksm_stable, ksm_compare_key, &key);
+    return (node != NULL) ? rbn2ksm(node)->page : NULL;
+}
+
+//ksm_stable_insert - make page a stable page, the caller write-protects its mapping
+static int
+ksm_stable_insert(struct Page *page, uint32_t sum) {
+    struct ksm_node *kn;
+    if ((kn = kmalloc(sizeof(struct ksm_node))) == NULL) {
+        return -E_NO_MEM;
+    }
+    kn->sum = sum;
+    kn->page = page;
+    rb_insert(ksm_stable, &(kn->rb_link));
+    SetPageKsm(page);
+    ksm_stat.nr_stable ++;
+    return 0;
+}
+
+//ksm_page_release - take a stable page out of the stable tree, called when it is no longer shared
+void
+ksm_page_release(struct Page *page) {
+    assert(PageKsm(page));
+    void *kva = page2kva(page);
+    struct ksm_key key = {ksm_checksum(kva), kva};
+    rb_node *node = rb_search(ksm_stable, ksm_compare_key, &key);
+    assert(node != NULL && rbn2ksm(node)->page == page);
+    rb_delete(ksm_stable, node);
+    kfree(rbn2ksm(node));
+    ClearPageKsm(page);
+    ksm_stat.nr_stable --;
+}
+
+//ksm_merge - map the stable page kpage read-only in place of the private page of *ptep (la in pgdir)
+static int
+ksm_merge(pde_t *pgdir, uintptr_t la, pte_t *ptep, struct Page *kpage) {
+    struct Page *page = pte2page(*ptep);
+    assert(PageKsm(kpage) && page_ref(page) == 1);
+    if (rmap_add(kpage, pgdir, la) != 0) {
+        return -E_NO_MEM;
+    }
+    rmap_remove(page, pgdir, la);
+    page_ref_inc(kpage);
+    *ptep = page2pa(kpage) | (*ptep & (PTE_USER | PTE_A) & ~PTE_W);
+    page_ref_dec(page);
+    free_page(page);
+    ksm_stat.nr_merged ++;
+    return 0;
+}
+
+//ksm_break_cow - a write to the read-only mapping *ptep of a writable vma, give the writer its own page
+int
+ksm_break_cow(pde_t *pgdir, uintptr_t la, pte_t *ptep, uint32_t perm) {
+    struct Page *page = pte2page(*ptep), *npage;
+    ksm_stat.nr_cow ++;
+    if (page_ref(page) == 1) {
+        // the last mapping, nobody else sees the page any more
+        if (PageKsm(page)) {
+            ksm_page_release(page);
+        }
+        *ptep |= perm;
+        tlb_invalidate_all();
+        return 0;
+    }
+    if ((npage = alloc_pages_flags(1, ALLOC_COLOUR(va_colour(la)))) == NULL) {
+        return -E_NO_MEM;
+    }
+    memcpy(page2kva(npage), page2kva(page), PGSIZE);
+    if (page_insert(pgdir, npage, la, perm) != 0) {
+        free_page(npage);
+        return -E_NO_MEM;
+    }
+    return 0;
+}
+
+//ksm_scan_page - try to merge the page mapped by *ptep at la in the mm of process pid
+static void
+ksm_scan_page(struct mm_struct *mm, int pid, uintptr_t la, pte_t *ptep) {
+    struct Page *page = pte2page(*ptep), *kpage;
+    if (!(*ptep & PTE_U) || PageKsm(page) || page_ref(page) != 1) {
+        return ;
+    }
+    void *kva = page2kva(page);
+    uint32_t sum = ksm_checksum(kva);
+    if ((kpage = ksm_stable_lookup(sum, kva)) != NULL) {
+        ksm_merge(mm->pgdir, la, ptep, kpage);
+        return ;
+    }
+
+    struct ksm_item *item = ksm_unstable + hash32(sum, KSM_UNSTABLE_SHIFT);
+    if (item->page != NULL && item->page != page && item->sum == sum) {
+        // the candidate may have been unmapped, written or merged since it was seen
+        struct proc_struct *proc = find_proc(item->pid);
+        struct mm_struct *imm = (proc != NULL) ? proc->mm : NULL;
+        if (imm != NULL && (imm == mm || try_down(&(imm->mm_sem)))) {
+            pte_t *iptep = get_pte(imm->pgdir, item->la, 0);
+            if (iptep != NULL && (*iptep & PTE_P) && pte2page(*iptep) == item->page
+                && !PageKsm(item->page) && page_ref(item->page) == 1
+                && memcmp(page2kva(item->page), kva, PGSIZE) == 0
+                && ksm_stable_insert(item->page, sum) == 0) {
+                *iptep &= ~PTE_W;
+                if (ksm_merge(mm->pgdir, la, ptep, item->page) == 0) {
+                    page = NULL;
+                }
+            }
+            if (imm != mm) {
+                up(&(imm->mm_sem));
+            }
+        }
+    }
+    item->pid = pid;
+    item->la = la;
+    item->page = page;
+    item->sum = sum;
+}
+
+//ksm_scan_mm - scan the pages of mm from ksm_cursor.la on, return true when the whole mm is done
+static bool
+ksm_scan_mm(struct mm_struct *mm, int pid, size_t *budget) {
+    uintptr_t la = ksm_cursor.la;
+    list_entry_t *list = &(mm->mmap_list), *le = list;
+    while ((le = list_next(le)) != list) {
+        struct vma_struct *vma = le2vma(le, list_link);
+        if (la < vma->vm_start) {
+            la = vma->vm_start;
+        }
+        for (; la < vma->vm_end; la += PGSIZE) {
+            if (*budget == 0) {
+                ksm_cursor.la = la;
+                return 0;
+            }
+            pte_t *ptep = get_pte(mm->pgdir, la, 0);
+            if (ptep == NULL) {
+                la = ROUNDDOWN_2N(la + PTSIZE, PTSHIFT) - PGSIZE;
+                continue ;
+            }
+            if (*ptep & PTE_P) {
+                (*budget) --;
+                ksm_scan_page(mm, pid, la, ptep);
+            }
+        }
+    }
+    return 1;
+}
+
+//ksm_scan - called by idleproc in cpu_idle, scan one batch of user pages per tick
+void
+ksm_scan(void) {
+    if (!ksm_init_ok || ksm_cursor.tick == ticks) {
+        return ;
+    }
+    ksm_cursor.tick = ticks;
+
+    size_t budget = KSM_PAGES_TO_SCAN, nr_merged_store = ksm_stat.nr_merged;
+    bool wrapped = 0;
+    struct proc_struct *proc;
+    list_entry_t *le;
+    if (ksm_cursor.pid != 0 && (proc = find_proc(ksm_cursor.pid)) != NULL) {
+        le = &(proc->list_link);
+    }
+    else {
+        le = list_next(&proc_list);
+        ksm_cursor.la = 0;
+    }
+    while (budget > 0 && !current->need_resched) {
+        if (le == &proc_list) {
+            if (wrapped) {
+                break;
+            }
+            // end of a round, the candidates may be stale by the time they are seen again
+            wrapped = 1;
+            memset(ksm_unstable, 0, sizeof(ksm_unstable));
+            ksm_stat.nr_full_scans ++;
+            le = list_next(le);
+            continue ;
+        }
+        proc = le2proc(le, list_link);
+        struct mm_struct *mm = proc->mm;
+        if (mm != NULL && try_down(&(mm->mm_sem))) {
+            bool done = ksm_scan_mm(mm, proc->pid, &budget);
+            up(&(mm->mm_sem));
+            if (!done) {
+                break;
+            }
+        }
+        ksm_cursor.la = 0;
+        le = list_next(le);
+    }
+    ksm_cursor.pid = (le != &proc_list) ? le2proc(le, list_link)->pid : 0;
+
+    if (ksm_stat.nr_merged != nr_merged_store) {
+        // stable pages and their new mappings were write-protected
+        tlb_invalidate_all();
+    }
+}
+
+//ksm_print_stat - pages_shared: # of stable pages, pages_sharing: # of mappings of them
+void
+ksm_print_stat(void) {
+    size_t sharing = 0;
+    rb_node *node = rb_node_root(ksm_stable), *left;
+    if (node != NULL) {
+        while ((left = rb_node_left(ksm_stable, node)) != NULL) {
+            node = left;
+        }
+        for (; node != NULL; node = rb_node_next(ksm_stable, node)) {
+            sharing += page_ref(rbn2ksm(node)->page);
+        }
+    }
+    kprintf("ksm: pages_shared %d, pages_sharing %d, saved %d pages.\n",
+            ksm_stat.nr_stable, sharing, sharing - ksm_stat.nr_stable);
+    kprintf("ksm: %d merged, %d cow faults, %d full scans.\n",
+            ksm_stat.nr_merged, ksm_stat.nr_cow, ksm_stat.nr_full_scans);
+}
+
+//ksm_init - create the stable tree and let cpu_idle start scanning
+void
+ksm_init(void) {
+    if ((ksm_stable = rb_tree_create(ksm_compare)) == NULL) {
+        panic("ksm_init: no memory for the stable tree.\n");
+    }
+    check_ksm();
+    ksm_init_ok = 1;
+    kprintf("ksm_init() succeeded!\n");
+}
+
+static void
+check_ksm(void) {
+    size_t nr_free_pages_store = nr_free_pages();
+    size_t slab_allocated_store = kallocated();
+
+    assert(boot_pgdir[0] == 0);
+    struct Page *p0 = alloc_page(), *p1 = alloc_page(), *p2;
+    assert(p0 != NULL && p1 != NULL);
+    memset(page2kva(p0), 0x5A, PGSIZE);
+    memset(page2kva(p1), 0x5A, PGSIZE);
+    assert(page_insert(boot_pgdir, p0, 0x0, PTE_U | PTE_W) == 0);
+    assert(page_insert(boot_pgdir, p1, PGSIZE, PTE_U | PTE_W) == 0);
+    pte_t *ptep0 = get_pte(boot_pgdir, 0x0, 0), *ptep1 = get_pte(boot_pgdir, PGSIZE, 0);
+
+    uint32_t sum = ksm_checksum(page2kva(p0));
+    assert(sum == ksm_checksum(page2kva(p1)));
+    assert(ksm_stable_lookup(sum, page2kva(p1)) == NULL);
+    assert(ksm_stable_insert(p0, sum) == 0);
+    *ptep0 &= ~PTE_W;
+    assert(ksm_stable_lookup(sum, page2kva(p1)) == p0);
+
+    // p1 is freed, both addresses map p0 read-only
+    assert(ksm_merge(boot_pgdir, PGSIZE, ptep1, p0) == 0);
+    assert(pte2page(*ptep1) == p0 && !(*ptep1 & PTE_W));
+    assert(page_ref(p0) == 2);
+
+    // a write through the second mapping gets a private copy
+    assert(ksm_break_cow(boot_pgdir, PGSIZE, ptep1, PTE_U | PTE_W) == 0);
+    assert((p2 = pte2page(*ptep1)) != p0 && (*ptep1 & PTE_W));
+    assert(memcmp(page2kva(p2), page2kva(p0), PGSIZE) == 0);
+    assert(page_ref(p0) == 1 && PageKsm(p0));
+
+    // unmapping the last mapping drops p0 from the stable tree
+    page_remove(boot_pgdir, 0x0);
+    assert(ksm_stat.nr_stable == 0 && ksm_stable_lookup(sum, page2kva(p2)) == NULL);
+    page_remove(boot_pgdir, PGSIZE);
+
+    free_page(pa2page(PDE_ADDR(boot_pgdir[0])));
+    boot_pgdir[0] = 0;
+    tlb_invalidate_all();
+    ksm_stat.nr_merged = ksm_stat.nr_cow = 0;
+
+    assert(nr_free_pages_store == nr_free_pages());
+    assert(slab_allocated_store == kallocated());
+
+    kprintf("check_ksm() succeeded!\n");
+}
+
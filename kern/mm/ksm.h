@@ -0,0 +1,19 @@
+// 相同页合并（ksm）的接口定义
+#ifndef __KERN_MM_KSM_H__
+#define __KERN_MM_KSM_H__
+
+#include <defs.h>
+#include <mmu.h>
+#include <memlayout.h>
+
+#define KSM_PAGES_TO_SCAN       32          // max # of pages hashed by one scan batch (at most one batch per tick)
+#define KSM_UNSTABLE_SHIFT      8           // the candidate table has 2^KSM_UNSTABLE_SHIFT slots
+
+void ksm_init(void);
+void ksm_scan(void);
+int ksm_break_cow(pde_t *pgdir, uintptr_t la, pte_t *ptep, uint32_t perm);
+void ksm_page_release(struct Page *page);
+void ksm_print_stat(void);
+
+#endif /* !__KERN_MM_KSM_H__ */
+
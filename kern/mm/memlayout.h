@@ -11,7 +11,7 @@
 
 #define KERNTOP             (KERNBASE + KMEMSIZE)
 
-#define KSTACKPAGE          2                           // # of pages in kernel stack
+#define KSTACKPAGE          2                           // # of pages in kernel stack, 1 is allowed (check kstack_max_depth in proc.c first)
 #define KSTACKSIZE          (KSTACKPAGE * 4096)       // sizeof kernel stack
 
 #define USERBASE            0x10000000              // 用户空间的起始地址
@@ -51,7 +51,7 @@ struct Page {
     int zone_num;                   // used in buddy system, the No. of zone which the page belongs to
     list_entry_t page_link;         // free list link
 //    swap_entry_t index;             // stores a swapped-out page identifier
-    list_entry_t swap_link;         // swap hash link
+    list_entry_t rmap_list;         // the PTEs mapping this page, a list of rmap_item (kern/mm/rmap.h)
 };
 
 /* Flags describing the status of a page frame */
@@ -61,6 +61,7 @@ struct Page {
 #define PG_dirty                    3       // the page has been modified
 #define PG_swap                     4       // the page is in the active or inactive page list (and swap hash table)
 #define PG_active                   5       // the page is in the active page list
+#define PG_ksm                      6       // the page is a merged read-only page in the ksm stable tree
 
 // 一些修改Page的控制信息的宏
 #define SetPageReserved(page)       set_bit(PG_reserved, &((page)->flags))
@@ -81,6 +82,9 @@ struct Page {
 #define SetPageActive(page)         set_bit(PG_active, &((page)->flags))
 #define ClearPageActive(page)       clear_bit(PG_active, &((page)->flags))
 #define PageActive(page)            test_bit(PG_active, &((page)->flags))
+#define SetPageKsm(page)            set_bit(PG_ksm, &((page)->flags))
+#define ClearPageKsm(page)          clear_bit(PG_ksm, &((page)->flags))
+#define PageKsm(page)               test_bit(PG_ksm, &((page)->flags))
 
 // convert list entry to page
 #define le2page(le, member)                 \
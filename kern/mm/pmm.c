@@ -7,6 +7,13 @@
 #include <memlayout.h>
 #include <pmm.h>
 #include <buddy_pmm.h>
+#include <zero_pool.h>
+#include <zswap.h>
+#include <ksm.h>
+#include <rmap.h>
+#include <alloc_prof.h>
+#include <proc.h>
+#include <kmalloc.h>
 #include <sync.h>
 #include <error.h>
 
@@ -57,25 +64,103 @@ init_memmap(struct Page *base, size_t n) {
     pmm_manager->init_memmap(base, n);
 }
 
-//alloc_pages - call pmm->alloc_pages to allocate a continuous n*PAGESIZE memory 
-struct Page *
-alloc_pages(size_t n) {
+//__alloc_pages - call pmm->alloc_pages to allocate a continuous n*PAGESIZE memory 
+static struct Page *
+__alloc_pages(size_t n) {
     struct Page *page;
     bool intr_flag;
     local_intr_save(intr_flag);
     {
         page = pmm_manager->alloc_pages(n);
+        // pages parked in the zero pool and in the proc cache are as good as free,
+        // hand them back before failing
+        if (page == NULL && zero_pool_drain() != 0) {
+            page = pmm_manager->alloc_pages(n);
+        }
+        if (page == NULL && proc_cache_shrink() != 0) {
+            page = pmm_manager->alloc_pages(n);
+        }
     }
     local_intr_restore(intr_flag);
     return page;
 }
 
+//alloc_pages - __alloc_pages, charged to the caller (see alloc_prof.h)
+struct Page *
+alloc_pages(size_t n) {
+    struct Page *page = __alloc_pages(n);
+    if (ALLOC_PROF && page != NULL) {
+        alloc_prof_pages(page, n, ALLOC_CALLER());
+    }
+    return page;
+}
+
+//alloc_page_colour - call pmm->alloc_page_colour to allocate a single page of colour,
+//                  - return NULL if the pmm has none at hand or does not support colours
+static struct Page *
+alloc_page_colour(size_t colour) {
+    struct Page *page = NULL;
+    if (pmm_manager->alloc_page_colour != NULL) {
+        bool intr_flag;
+        local_intr_save(intr_flag);
+        {
+            page = pmm_manager->alloc_page_colour(colour);
+        }
+        local_intr_restore(intr_flag);
+    }
+    return page;
+}
+
+//__alloc_pages_flags - __alloc_pages with ALLOC_* flags (see pmm.h)
+//                  - ALLOC_ZEROED: single pages come from the zero pool if possible,
+//                  - otherwise the pages are cleared here
+//                  - ALLOC_COLOURED: a single page of the wanted colour is tried first (the zero
+//                  - pool, then the pmm), any page is returned if there is none
+static struct Page *
+__alloc_pages_flags(size_t n, uint32_t alloc_flags) {
+    struct Page *page;
+    if ((alloc_flags & ALLOC_COLOURED) && n == 1 && NR_PAGE_COLOURS > 1) {
+        size_t colour = (alloc_flags >> 8) & (NR_PAGE_COLOURS - 1);
+        if ((alloc_flags & ALLOC_ZEROED) && (page = zero_pool_get_colour(colour)) != NULL) {
+            return page;
+        }
+        if ((page = alloc_page_colour(colour)) != NULL) {
+            if (alloc_flags & ALLOC_ZEROED) {
+                memset(page2kva(page), 0, PGSIZE);
+            }
+            return page;
+        }
+    }
+    if ((alloc_flags & ALLOC_ZEROED) && n == 1) {
+        if ((page = zero_pool_get()) != NULL) {
+            return page;
+        }
+    }
+    if ((page = __alloc_pages(n)) != NULL && (alloc_flags & ALLOC_ZEROED)) {
+        memset(page2kva(page), 0, n * PGSIZE);
+    }
+    return page;
+}
+
+//alloc_pages_flags - __alloc_pages_flags, charged to the caller
+struct Page *
+alloc_pages_flags(size_t n, uint32_t alloc_flags) {
+    struct Page *page = __alloc_pages_flags(n, alloc_flags);
+    if (ALLOC_PROF && page != NULL) {
+        alloc_prof_pages(page, n, ALLOC_CALLER());
+    }
+    return page;
+}
+
 //free_pages - call pmm->free_pages to free a continuous n*PAGESIZE memory 
 void
 free_pages(struct Page *base, size_t n) {
     bool intr_flag;
     local_intr_save(intr_flag);
     {
+        if (ALLOC_PROF) {
+            alloc_prof_free_pages(base, n);
+        }
         pmm_manager->free_pages(base, n);
     }
     local_intr_restore(intr_flag);
@@ -89,7 +174,7 @@ nr_free_pages(void) {
     bool intr_flag;
     local_intr_save(intr_flag);
     {
-        ret = pmm_manager->nr_free_pages();
+        ret = pmm_manager->nr_free_pages() + zero_pool_nr();
     }
     local_intr_restore(intr_flag);
     return ret;
@@ -122,6 +207,7 @@ page_init(void) {
   pages = (struct Page *)ROUNDUP_2N((void *)end, PGSHIFT); 
   for(i=0; i < npage; i++){
     SetPageReserved(pages + i);
+    list_init(&(pages[i].rmap_list));
   }
 
   uintptr_t freemem = PADDR((uintptr_t)pages + sizeof(struct Page) * npage);
@@ -182,6 +268,7 @@ pmm_init(void) {
     //Then pmm can alloc/free the physical memory. 
     //Now the first_fit/best_fit/worst_fit/buddy_system pmm are available.
     init_pmm_manager();
+    zero_pool_init();
 
     // detect physical memory space, reserve already used memory,
     // then use pmm->init_memmap to create free page list
@@ -189,6 +276,10 @@ pmm_init(void) {
 
     // use pmm->check to verify the correctness of the alloc/free function in a pmm
     check_alloc_page();
+
+    // page_insert records every mapping with a kmalloc'ed rmap_item (rmap.c),
+    // so the slab allocator must be ready before the first page table is built
+    kmalloc_init();
     
     // create boot_pgdir, an initial page directory(Page Directory Table, PDT)
     boot_pgdir = boot_alloc_page();
@@ -197,6 +288,7 @@ pmm_init(void) {
     current_pgdir = boot_pgdir;
 
     check_pgdir();
+    check_rmap();
 
     enable_paging();
 
@@ -206,8 +298,6 @@ pmm_init(void) {
 
     memset(boot_pgdir, 0, PGSIZE);
     print_pgdir();
-
-  	kmalloc_init();
 }
 
 //get_pte - get pte and return the kernel virtual address of this pte for la
@@ -233,12 +323,11 @@ get_pte(pde_t *pgdir, uintptr_t la, bool create) {
     if(!create) return NULL;
 		// CAUTION: this page is used for page table, not for common data page
 		// set page reference
-    struct Page* new_pte = alloc_page();
+    // the page comes from the zero pool if possible, so no memset here
+    struct Page* new_pte = alloc_zeroed_page();
     if(!new_pte) return NULL;
     page_ref_inc(new_pte); 
 		uintptr_t pa = (uintptr_t)page2kva(new_pte); // get linear address of page
-		// clear page content using memset
-    memset((void*)pa, 0, PGSIZE);
     //kprintf("@@@ %x\n", pa);
 		// set page directory entry's permission
     *pdep = PADDR(pa);
@@ -270,15 +359,23 @@ static inline void
 page_remove_pte(pde_t *pgdir, uintptr_t la, pte_t *ptep) {
 	if (ptep && (*ptep & PTE_P)) { // check if page directory is present
 		struct Page *page = pte2page(*ptep); // find corresponding page to pte
+    rmap_remove(page, pgdir, la);
 		// decrease page reference
     page_ref_dec(page);
 		// and free it when reach 0
     if(page_ref(page) == 0){
+       if (PageKsm(page)) { // the last mapping of a merged page, drop it from the stable tree
+         ksm_page_release(page);
+       }
        free_page(page);
     }
 		// clear page directory entry
     *ptep = 0;
 	}
+  else if (ptep && pte_is_zswap(*ptep)) { // the page lives in zswap, drop the compressed copy
+    zswap_entry_free(*ptep);
+    *ptep = 0;
+  }
 		// flush tlb
   tlb_invalidate_all();
 }
@@ -298,7 +395,7 @@ page_remove(pde_t *pgdir, uintptr_t la) {
 //  page:  the Page which need to map
 //  la:    the linear address need to map
 //  perm:  the permission of this Page which is setted in related pte
-// return value: always 0
+// return value: 0, or -E_NO_MEM if the PT or the rmap_item can not be allocated
 //note: PT is changed, so the TLB need to be invalidate 
 int
 page_insert(pde_t *pgdir, struct Page *page, uintptr_t la, uint32_t perm) {
@@ -307,12 +404,16 @@ page_insert(pde_t *pgdir, struct Page *page, uintptr_t la, uint32_t perm) {
         return -E_NO_MEM;
     }
     page_ref_inc(page);
-    if (*ptep & PTE_P) {
-        struct Page *p = pte2page(*ptep);
-        if (p == page) {
+    if ((*ptep & PTE_P) && pte2page(*ptep) == page) {
+        page_ref_dec(page);
+    }
+    else {
+        // record the new mapping first, the old one is kept if that fails
+        if (rmap_add(page, pgdir, la) != 0) {
             page_ref_dec(page);
+            return -E_NO_MEM;
         }
-        else {
+        if ((*ptep & PTE_P) || pte_is_zswap(*ptep)) {
             page_remove_pte(pgdir, la, ptep);
         }
     }
@@ -321,26 +422,40 @@ page_insert(pde_t *pgdir, struct Page *page, uintptr_t la, uint32_t perm) {
     return 0;
 }
 
-extern int swap_init_ok;
-// pgdir_alloc_page - call alloc_page & page_insert functions to 
-//                  - allocate a page size memory & setup an addr map
-//                  - pa<->la with linear address la and the PDT pgdir
-struct Page *
-pgdir_alloc_page(pde_t *pgdir, uintptr_t la, uint32_t perm) {
-  struct Page *page = alloc_page();
+// __pgdir_alloc_page - the page is charged to caller, see pgdir_alloc_page*
+static struct Page *
+__pgdir_alloc_page(pde_t *pgdir, uintptr_t la, uint32_t perm, uint32_t alloc_flags, uintptr_t caller) {
+  if (alloc_flags & ALLOC_COLOURED) {
+    alloc_flags |= ALLOC_COLOUR(va_colour(la));
+  }
+  struct Page *page = __alloc_pages_flags(1, alloc_flags);
   if (page != NULL) {
+    if (ALLOC_PROF) {
+      alloc_prof_pages(page, 1, caller);
+    }
     if (page_insert(pgdir, page, la, perm) != 0) {
       free_page(page);
       return NULL;
     }
-    if (swap_init_ok){
-        panic("No swap!! never reach!!"); 
-    }
   }
 
   return page;
 }
 
+// pgdir_alloc_page - call alloc_page & page_insert functions to 
+//                  - allocate a page size memory & setup an addr map
+//                  - pa<->la with linear address la and the PDT pgdir
+struct Page *
+pgdir_alloc_page(pde_t *pgdir, uintptr_t la, uint32_t perm) {
+  return __pgdir_alloc_page(pgdir, la, perm, 0, ALLOC_CALLER());
+}
+
+// pgdir_alloc_page_flags - pgdir_alloc_page with ALLOC_* flags for the new page
+struct Page *
+pgdir_alloc_page_flags(pde_t *pgdir, uintptr_t la, uint32_t perm, uint32_t alloc_flags) {
+  return __pgdir_alloc_page(pgdir, la, perm, alloc_flags, ALLOC_CALLER());
+}
+
 static void
 check_alloc_page(void) {
   pmm_manager->check();
@@ -424,7 +539,9 @@ check_boot_pgdir(void) {
   *(char *)(page2kva(p) + 0x100) = '\0';
   assert(strlen((const char *)0x100) == 0);
 
-  free_page(p);
+  page_remove(boot_pgdir, 0x100);
+  page_remove(boot_pgdir, 0x100 + PGSIZE);
+  assert(page_ref(p) == 0);
   free_page(pa2page(PDE_ADDR(boot_pgdir[0])));
   boot_pgdir[0] = 0;
   tlb_invalidate_all();
@@ -553,6 +670,8 @@ copy_range(pde_t *to, pde_t *from, uintptr_t start, uintptr_t end, bool share) {
     assert(USER_ACCESS(start, end));
 
     do {
+        // the caller holds the mm lock of from, let a waiting process in between pages
+        cond_resched();
         pte_t *ptep = get_pte(from, start, 0), *nptep;
         if (ptep == NULL) {
             start = ROUNDDOWN_2N(start + PTSIZE, PGSHIFT);
@@ -564,16 +683,31 @@ copy_range(pde_t *to, pde_t *from, uintptr_t start, uintptr_t end, bool share) {
           }
           uint32_t perm = (*ptep & PTE_USER);
           struct Page *page = pte2page(*ptep);
-          struct Page *npage=alloc_page();
           assert(page!=NULL);
+          if (PageKsm(page)) { // a merged page is read-only, the child maps it too and copies it on its first write
+            if (page_insert(to, page, start, perm) != 0) {
+              return -E_NO_MEM;
+            }
+            start += PGSIZE;
+            continue ;
+          }
+          struct Page *npage=alloc_pages_flags(1, ALLOC_COLOUR(va_colour(start)));
           assert(npage!=NULL);
           int ret=0;
           //LAB5:EXERCISE2 2009010989
           //replicate content of page to npage, build the map of phy addr of nage with the linear addr start
           memcpy(page2kva(npage), page2kva(page), PGSIZE);
-          page_insert(to, npage, start,perm);
-
-          assert(ret == 0);
+          if ((ret = page_insert(to, npage, start, perm)) != 0) {
+            free_page(npage);
+            return ret;
+          }
+        }
+        else if (pte_is_zswap(*ptep)) { // share the compressed copy, the first fault of either side decompresses it
+          if ((nptep = get_pte(to, start, 1)) == NULL) {
+            return -E_NO_MEM;
+          }
+          zswap_entry_dup(*ptep);
+          *nptep = *ptep;
         }
         start += PGSIZE;
     } while (start != 0 && start < end);
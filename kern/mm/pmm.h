@@ -12,6 +12,24 @@
 #define CLONE_VM            0x00000100  // set if VM shared between processes
 #define CLONE_THREAD        0x00000200  // thread group
 
+/* alloc flags used in alloc_pages_flags & pgdir_alloc_page_flags */
+#define ALLOC_ZEROED        0x00000001  // the caller needs zero-filled pages, prefer the zero pool
+#define ALLOC_COLOURED      0x00000002  // a single page of the colour in bits 8~15 is preferred (ALLOC_COLOUR),
+                                        // pgdir_alloc_page_flags fills in the colour of la itself
+
+/* *
+ * Page colouring. The caches of the boards are direct-mapped and physically indexed, so
+ * two pages whose page numbers agree in the low PAGE_COLOUR_SHIFT bits share their cache
+ * sets. User pages are allocated with the colour of their virtual page number, so that a
+ * virtually contiguous buffer no larger than the cache never evicts itself.
+ * PAGE_COLOUR_SHIFT 0 turns colouring off.
+ * */
+#define PAGE_COLOUR_SHIFT   2           // 4 colours: a 16KB direct-mapped cache of 4KB pages
+#define NR_PAGE_COLOURS     (1 << PAGE_COLOUR_SHIFT)
+#define page_colour(page)   (page2ppn(page) & (NR_PAGE_COLOURS - 1))
+#define va_colour(va)       (((uintptr_t)(va) >> PGSHIFT) & (NR_PAGE_COLOURS - 1))
+#define ALLOC_COLOUR(c)     (ALLOC_COLOURED | ((uint32_t)(c) << 8))
+
 // pmm_manager is a physical memory management class. A special pmm manager - XXX_pmm_manager
 // only needs to implement the methods in pmm_manager class, then XXX_pmm_manager can be used
 // by ucore to manage the total physical memory space.
@@ -22,6 +40,8 @@ struct pmm_manager {
     void (*init_memmap)(struct Page *base, size_t n); // setup description&management data structcure according to
                                                       // the initial free physical memory space 
     struct Page *(*alloc_pages)(size_t n);            // allocate >=n pages, depend on the allocation algorithm 
+    struct Page *(*alloc_page_colour)(size_t colour); // allocate a single page of this colour, NULL if none is
+                                                      // at hand (optional, may be NULL)
     void (*free_pages)(struct Page *base, size_t n);  // free >=n pages with "base" addr of Page descriptor structures(memlayout.h)
     size_t (*nr_free_pages)(void);                    // return the number of free pages 
     void (*check)(void);                              // check the correctness of XXX_pmm_manager 
@@ -36,6 +56,7 @@ void pmm_init(void);
 struct Page *alloc_pages(size_t n);
 void free_pages(struct Page *base, size_t n);
 size_t nr_free_pages(void);
+struct Page *alloc_pages_flags(size_t n, uint32_t alloc_flags);
 
 
 void unmap_range(pde_t *pgdir, uintptr_t start, uintptr_t end);
@@ -44,12 +65,14 @@ int copy_range(pde_t *to, pde_t *from, uintptr_t start, uintptr_t end, bool shar
 
 #define alloc_page() alloc_pages(1)
 #define free_page(page) free_pages(page, 1)
+#define alloc_zeroed_page() alloc_pages_flags(1, ALLOC_ZEROED)
 
 pte_t *get_pte(pde_t *pgdir, uintptr_t la, bool create);
 struct Page *get_page(pde_t *pgdir, uintptr_t la, pte_t **ptep_store);
 void page_remove(pde_t *pgdir, uintptr_t la);
 int page_insert(pde_t *pgdir, struct Page *page, uintptr_t la, uint32_t perm);
 struct Page * pgdir_alloc_page(pde_t *pgdir, uintptr_t la, uint32_t perm);
+struct Page * pgdir_alloc_page_flags(pde_t *pgdir, uintptr_t la, uint32_t perm, uint32_t alloc_flags);
 
 
 void print_pgdir(void);
@@ -0,0 +1,136 @@
+// 反向映射（rmap）：记录每个物理页被哪些页表项映射，可以遍历或一次解除所有映射
+#include <defs.h>
+#include <list.h>
+#include <stdio.h>
+#include <assert.h>
+#include <error.h>
+#include <kmalloc.h>
+#include <pmm.h>
+#include <rmap.h>
+
+/* Each struct Page heads a list of rmap_item, one per PTE that maps it. The list head
+   reuses the slot of the old swap_link, so struct Page does not grow; the cost is one
+   kmalloc'ed item (the smallest slab object) per present user PTE. Pages that are not
+   mapped by any page table (page tables themselves, slab pages, kernel stacks) have an
+   empty list.
+
+   The list is kept by page_insert and page_remove_pte in pmm.c. Code that writes a
+   PTE by hand must call rmap_add / rmap_remove itself (see fault_around in vmm.c,
+   ksm_merge in ksm.c and zswap_swap_out in zswap.c).
+*/
+
+//rmap_add - record that the PTE of la in pgdir maps page
+int
+rmap_add(struct Page *page, pde_t *pgdir, uintptr_t la) {
+    struct rmap_item *item;
+    if ((item = kmalloc(sizeof(struct rmap_item))) == NULL) {
+        return -E_NO_MEM;
+    }
+    item->pgdir = pgdir;
+    item->la = ROUNDDOWN_2N(la, PGSHIFT);
+    list_add(&(page->rmap_list), &(item->rmap_link));
+    return 0;
+}
+
+//rmap_remove - forget the mapping of page at la in pgdir, it must have been recorded
+void
+rmap_remove(struct Page *page, pde_t *pgdir, uintptr_t la) {
+    la = ROUNDDOWN_2N(la, PGSHIFT);
+    list_entry_t *list = &(page->rmap_list), *le = list;
+    while ((le = list_next(le)) != list) {
+        struct rmap_item *item = le2rmap(le, rmap_link);
+        if (item->pgdir == pgdir && item->la == la) {
+            list_del(le);
+            kfree(item);
+            return ;
+        }
+    }
+    panic("rmap_remove: page %08x is not mapped at %08x.\n", page2pa(page), la);
+}
+
+//page_mapcount - the number of PTEs mapping page
+size_t
+page_mapcount(struct Page *page) {
+    size_t n = 0;
+    list_entry_t *list = &(page->rmap_list), *le = list;
+    while ((le = list_next(le)) != list) {
+        n ++;
+    }
+    return n;
+}
+
+/* *
+ * rmap_walk - call fn on every mapping of page, stop at the first non-zero return value
+ * and return it. fn may change the permission of the PTE but must not remove it.
+ * */
+int
+rmap_walk(struct Page *page, int (*fn)(struct Page *page, pde_t *pgdir, uintptr_t la, void *arg), void *arg) {
+    int ret;
+    list_entry_t *list = &(page->rmap_list), *le = list;
+    while ((le = list_next(le)) != list) {
+        struct rmap_item *item = le2rmap(le, rmap_link);
+        if ((ret = fn(page, item->pgdir, item->la, arg)) != 0) {
+            return ret;
+        }
+    }
+    return 0;
+}
+
+/* *
+ * try_to_unmap - remove every mapping of page, return the number of PTEs cleared.
+ * page is freed with its last mapping unless the caller holds a reference of its own.
+ * */
+size_t
+try_to_unmap(struct Page *page) {
+    size_t n = 0;
+    list_entry_t *list = &(page->rmap_list), *le;
+    while ((le = list_next(list)) != list) {
+        struct rmap_item *item = le2rmap(le, rmap_link);
+        page_remove(item->pgdir, item->la);
+        n ++;
+    }
+    return n;
+}
+
+static int
+check_rmap_sum(struct Page *page, pde_t *pgdir, uintptr_t la, void *arg) {
+    assert(pgdir == boot_pgdir && get_page(pgdir, la, NULL) == page);
+    *(uintptr_t *)arg += la;
+    return 0;
+}
+
+void
+check_rmap(void) {
+    size_t nr_free_pages_store = nr_free_pages();
+    size_t slab_allocated_store = kallocated();
+
+    assert(boot_pgdir[0] == 0);
+    struct Page *p = alloc_page();
+    assert(p != NULL && page_mapcount(p) == 0);
+    assert(page_insert(boot_pgdir, p, 0x0, PTE_U) == 0);
+    assert(page_insert(boot_pgdir, p, PGSIZE, PTE_U) == 0);
+    // changing the permission of a mapping does not add one
+    assert(page_insert(boot_pgdir, p, PGSIZE, PTE_U | PTE_W) == 0);
+    assert(page_mapcount(p) == 2 && page_ref(p) == 2);
+
+    uintptr_t sum = 0;
+    assert(rmap_walk(p, check_rmap_sum, &sum) == 0 && sum == PGSIZE);
+
+    page_remove(boot_pgdir, 0x0);
+    assert(page_mapcount(p) == 1 && page_ref(p) == 1);
+    assert(page_insert(boot_pgdir, p, 2 * PGSIZE, PTE_U) == 0);
+
+    // p is freed with its last mapping
+    assert(try_to_unmap(p) == 2);
+    assert(page_mapcount(p) == 0 && page_ref(p) == 0);
+    assert(get_page(boot_pgdir, PGSIZE, NULL) == NULL && get_page(boot_pgdir, 2 * PGSIZE, NULL) == NULL);
+
+    free_page(pa2page(PDE_ADDR(boot_pgdir[0])));
+    boot_pgdir[0] = 0;
+
+    assert(nr_free_pages_store == nr_free_pages());
+    assert(slab_allocated_store == kallocated());
+
+    kprintf("check_rmap() succeeded!\n");
+}
+
@@ -0,0 +1,33 @@
+// 反向映射（rmap）的接口定义：由物理页找到映射它的所有 PTE
+#ifndef __KERN_MM_RMAP_H__
+#define __KERN_MM_RMAP_H__
+
+#include <defs.h>
+#include <list.h>
+#include <memlayout.h>
+
+/* *
+ * Every PTE that maps a struct Page is recorded by one rmap_item on page->rmap_list.
+ * page_insert adds the item and page_remove_pte drops it, so the list always matches
+ * the page tables. A mapping is named by its page directory, which is all the pmm layer
+ * knows of an address space (one pgdir per mm).
+ * */
+struct rmap_item {
+    pde_t *pgdir;               // the page directory of the mapping
+    uintptr_t la;               // the linear address of the mapping, page aligned
+    list_entry_t rmap_link;     // entry in page->rmap_list
+};
+
+#define le2rmap(le, member)                 \
+    to_struct((le), struct rmap_item, member)
+
+int rmap_add(struct Page *page, pde_t *pgdir, uintptr_t la);
+void rmap_remove(struct Page *page, pde_t *pgdir, uintptr_t la);
+size_t page_mapcount(struct Page *page);
+int rmap_walk(struct Page *page, int (*fn)(struct Page *page, pde_t *pgdir, uintptr_t la, void *arg), void *arg);
+size_t try_to_unmap(struct Page *page);
+
+void check_rmap(void);
+
+#endif /* !__KERN_MM_RMAP_H__ */
+
@@ -8,6 +8,10 @@
 #include <kmalloc.h>
 #include <pmm.h>
 #include <thumips_tlb.h>
+#include <zswap.h>
+#include <ksm.h>
+#include <zero_pool.h>
+#include <rmap.h>
 
 /* 
    vmm design include two parts: mm_struct (mm) & vma_struct (vma)
@@ -52,6 +56,7 @@ mm_create(void) {
     mm->map_count = 0;
 
     mm->sm_priv = NULL;
+    mm->ras = NULL;
 
     set_mm_count(mm, 0);
     sem_init(&(mm->mm_sem), 1);
@@ -152,6 +157,9 @@ mm_destroy(struct mm_struct *mm) {
     list_del(le);
     kfree(le2vma(le, list_link));  //kfree vma		
   }
+  if (mm->ras != NULL) {
+    kfree(mm->ras);
+  }
   kfree(mm); //kfree mm
   mm=NULL;
 }
@@ -215,6 +223,8 @@ exit_mmap(struct mm_struct *mm) {
   assert(mm != NULL && mm_count(mm) == 0);
   pde_t *pgdir = mm->pgdir;
   list_entry_t *list = &(mm->mmap_list), *le = list;
+  // the rmap lists of shared (COW, ksm) pages are also changed by their other mappers
+  preempt_disable();
   while ((le = list_next(le)) != list) {
     struct vma_struct *vma = le2vma(le, list_link);
     unmap_range(pgdir, vma->vm_start, vma->vm_end);
@@ -223,6 +233,7 @@ exit_mmap(struct mm_struct *mm) {
     struct vma_struct *vma = le2vma(le, list_link);
     exit_range(pgdir, vma->vm_start, vma->vm_end);
   }
+  preempt_enable();
 }
 
 bool
@@ -344,7 +355,10 @@ check_pgfault(void) {
   }
   assert(sum == 0);
 
-  page_remove(pgdir, ROUNDDOWN_2N(addr, PGSHIFT));
+  // the fault may have mapped its neighbours as well (fault_around)
+  for (i = 0; i < FAULT_AROUND_PAGES; i ++) {
+    page_remove(pgdir, ROUNDDOWN_2N(addr, PGSHIFT) + i * PGSIZE);
+  }
   free_page(pa2page(pgdir[0]));
   pgdir[0] = 0;
 
@@ -361,6 +375,64 @@ check_pgfault(void) {
 
 //page fault number
 volatile unsigned int pgfault_num=0;
+static struct {
+    size_t nr_faults;           // demand faults that mapped pages around them
+    size_t nr_mapped;           // pages mapped by fault-around
+    size_t nr_touched;          // of which were accessed afterwards
+} fault_around_stat;
+
+// fault_around - map zeroed pages at the empty PTEs of the FAULT_AROUND_PAGES window around addr.
+//              - ptep is the PTE of addr; an aligned window never crosses a page table.
+//              - Only pages the zero pool already has are used, so this costs no memset.
+static void
+fault_around(struct mm_struct *mm, struct vma_struct *vma, uintptr_t addr, pte_t *ptep, uint32_t perm) {
+  static_assert((FAULT_AROUND_PAGES & (FAULT_AROUND_PAGES - 1)) == 0);
+  uintptr_t start = addr & ~(FAULT_AROUND_PAGES * PGSIZE - 1);
+  uintptr_t end = start + FAULT_AROUND_PAGES * PGSIZE, la;
+  if (start < vma->vm_start) {
+    start = vma->vm_start;
+  }
+  if (end > vma->vm_end) {
+    end = vma->vm_end;
+  }
+  pte_t *pt = ptep - PTX(addr);
+  size_t nr_mapped_store = fault_around_stat.nr_mapped;
+  for (la = start; la < end; la += PGSIZE) {
+    pte_t *p = pt + PTX(la);
+    if (*p != 0) {
+      continue ;
+    }
+    struct Page *page;
+    if ((page = zero_pool_get_colour(va_colour(la))) == NULL && (page = zero_pool_get()) == NULL) {
+      break;
+    }
+    if (rmap_add(page, mm->pgdir, la) != 0) {
+      free_page(page);
+      break;
+    }
+    // no TLB flush: the whole TLB was just flushed by page_insert of addr
+    page_ref_inc(page);
+    *p = page2pa(page) | PTE_P | perm | PTE_FA;
+    fault_around_stat.nr_mapped ++;
+  }
+  if (fault_around_stat.nr_mapped != nr_mapped_store) {
+    fault_around_stat.nr_faults ++;
+  }
+}
+
+// fault_around_touch - called by the TLB refill path on the first access to a page mapped by fault_around
+void
+fault_around_touch(pte_t *ptep) {
+  *ptep &= ~PTE_FA;
+  fault_around_stat.nr_touched ++;
+}
+
+void
+print_fault_around_stat(void) {
+  kprintf("fault-around: %d faults mapped %d extra pages, %d of them were touched.\n",
+      fault_around_stat.nr_faults, fault_around_stat.nr_mapped, fault_around_stat.nr_touched);
+}
+
 // do_pgfault - interrupt handler to process the page fault execption
 int
 do_pgfault(struct mm_struct *mm, uint32_t error_code, uintptr_t addr) {
@@ -412,14 +484,27 @@ do_pgfault(struct mm_struct *mm, uint32_t error_code, uintptr_t addr) {
   }
 
   if (*ptep == 0) { // if the phy addr isn't exist, then alloc a page & map the phy addr with logical addr
-    if (pgdir_alloc_page(mm->pgdir, addr, perm) == NULL) {
+    // anonymous memory must read as zero, take the page from the zero pool
+    if (pgdir_alloc_page_flags(mm->pgdir, addr, perm, ALLOC_ZEROED | ALLOC_COLOURED) == NULL) {
+      // out of memory: compress some cold pages into zswap and try once more
+      if (!swap_init_ok || zswap_reclaim(ZSWAP_BATCH) == 0
+          || pgdir_alloc_page_flags(mm->pgdir, addr, perm, ALLOC_ZEROED | ALLOC_COLOURED) == NULL) {
+        goto failed;
+      }
+    }
+    fault_around(mm, vma, addr, ptep, perm);
+  }
+  else if (*ptep & PTE_P) { // write to a read-only page of a writable vma: the page was merged by ksm, copy it
+    if (ksm_break_cow(mm->pgdir, addr, ptep, perm) != 0) {
       goto failed;
     }
   }
-  else { // if this pte is a swap entry, then load data from disk to a page with phy addr, 
-    // map the phy addr with logical addr, trig swap manager to record the access situation of this page
-    if(swap_init_ok) {
-      panic("No swap!! never reach!!"); 
+  else { // if this pte is a swap entry, then load data from zswap to a page with phy addr, 
+    // map the phy addr with logical addr
+    if(swap_init_ok && pte_is_zswap(*ptep)) {
+      if (zswap_swap_in(mm->pgdir, addr, ptep, perm) != 0) {
+        goto failed;
+      }
     }
     else {
       kprintf("no swap_init_ok but ptep is %x, failed\n",*ptep);
@@ -484,3 +569,27 @@ copy_string(struct mm_struct *mm, char *dst, const char *src, size_t maxn)
     part = PGSIZE;
   }
 }
+
+// strnlen_user - the length of the string src in mm, or -1 if it is not readable or
+//              - does not end within maxn bytes (the '\0' included)
+int
+strnlen_user(struct mm_struct *mm, const char *src, size_t maxn)
+{
+  size_t alen, len = 0, part = ROUNDDOWN_2N((uintptr_t)src + PGSIZE, PGSHIFT) - (uintptr_t)src;
+  while (1) {
+    if (part > maxn) {
+      part = maxn;
+    }
+    if (!user_mem_check(mm, (uintptr_t)src, part, 0)) {
+      return -1;
+    }
+    if ((alen = strnlen(src, part)) < part) {
+      return len + alen;
+    }
+    if (part == maxn) {
+      return -1;
+    }
+    len += part, src += part, maxn -= part;
+    part = PGSIZE;
+  }
+}
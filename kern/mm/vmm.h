@@ -12,6 +12,7 @@
 
 // pre define
 struct mm_struct;
+struct ras_set;
 
 // the virtual continuous memory area(vma)
 // 管理虚拟内存区域的数据结构
@@ -46,6 +47,7 @@ struct mm_struct {
 	atomic_t mm_count;
 	semaphore_t mm_sem;
 	int locked_by;
+    struct ras_set *ras;           // the restartable atomic sequences, see ras.c
 
 };
 
@@ -60,12 +62,24 @@ void vmm_init(void);
 
 int do_pgfault(struct mm_struct *mm, uint32_t error_code, uintptr_t addr);
 
+/* *
+ * On a demand fault do_pgfault also maps the other not yet mapped pages of the aligned
+ * window of FAULT_AROUND_PAGES pages around the faulting address (within the same vma and
+ * page table), as long as the zero pool can supply them. Must be a power of 2, 1 disables it.
+ * */
+#define FAULT_AROUND_PAGES      8
+
+void fault_around_touch(pte_t *ptep);
+void print_fault_around_stat(void);
+
 extern volatile unsigned int pgfault_num;
 extern struct mm_struct *check_mm_struct;
 
 bool user_mem_check(struct mm_struct *mm, uintptr_t start, size_t len, bool write);
 bool copy_from_user(struct mm_struct *mm, void *dst, const void *src, size_t len, bool writable);
 bool copy_to_user(struct mm_struct *mm, void *dst, const void *src, size_t len);
+bool copy_string(struct mm_struct *mm, char *dst, const char *src, size_t maxn);
+int strnlen_user(struct mm_struct *mm, const char *src, size_t maxn);
 
 int mm_unmap(struct mm_struct *mm, uintptr_t addr, size_t len);
 int dup_mmap(struct mm_struct *to, struct mm_struct *from);
@@ -0,0 +1,147 @@
+// 预清零页池：由空闲进程在 cpu_idle 中提前把页清零，供需要全零页的分配路径直接取用
+#include <defs.h>
+#include <list.h>
+#include <sync.h>
+#include <string.h>
+#include <proc.h>
+#include <pmm.h>
+#include <zero_pool.h>
+
+/* The zero pool keeps a small stock of pages whose contents are already zero, so that
+   get_pte, do_pgfault, setup_pgdir and the BSS part of load_icode do not have to memset
+   a whole page on the critical path (see ALLOC_ZEROED in pmm.h).
+
+   The pool is refilled by idleproc from cpu_idle: once it drops below ZERO_POOL_LOW the
+   idle loop zeroes pages until ZERO_POOL_HIGH is reached. Zeroing is done ZERO_POOL_CHUNK
+   bytes at a time and is abandoned as soon as need_resched is set; the half-zeroed page
+   stays in zero_pool.filling and is finished on the next idle pass.
+
+   Pages in the pool (and the one being filled) still count as free memory: nr_free_pages
+   adds zero_pool_nr(), and alloc_pages drains the pool back into the buddy system before
+   reporting that it is out of memory.
+*/
+
+static struct {
+    list_entry_t list;          // zeroed pages, linked through page_link
+    size_t nr;                  // # of pages in list
+    struct Page *filling;       // page being zeroed by the idle loop
+    size_t fill_off;            // # of bytes of filling already zeroed
+    bool refilling;             // set between crossing the low and reaching the high watermark
+} zero_pool;
+
+//zero_pool_init - must be called before the first alloc_pages
+void
+zero_pool_init(void) {
+    list_init(&(zero_pool.list));
+    zero_pool.nr = 0;
+    zero_pool.filling = NULL;
+    zero_pool.fill_off = 0;
+    zero_pool.refilling = 0;
+}
+
+//zero_pool_get - take one zeroed page from the pool, return NULL if the pool is empty
+struct Page *
+zero_pool_get(void) {
+    struct Page *page = NULL;
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        if (zero_pool.nr > 0) {
+            list_entry_t *le = list_next(&(zero_pool.list));
+            list_del(le);
+            zero_pool.nr --;
+            page = le2page(le, page_link);
+        }
+    }
+    local_intr_restore(intr_flag);
+    return page;
+}
+
+//zero_pool_get_colour - take one zeroed page of colour (see page_colour in pmm.h), NULL if the pool has none
+struct Page *
+zero_pool_get_colour(size_t colour) {
+    struct Page *page = NULL;
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        list_entry_t *le = &(zero_pool.list);
+        while ((le = list_next(le)) != &(zero_pool.list)) {
+            if (page_colour(le2page(le, page_link)) == colour) {
+                list_del(le);
+                zero_pool.nr --;
+                page = le2page(le, page_link);
+                break;
+            }
+        }
+    }
+    local_intr_restore(intr_flag);
+    return page;
+}
+
+//zero_pool_nr - the number of pages held by the pool, including the one being zeroed
+size_t
+zero_pool_nr(void) {
+    return zero_pool.nr + (zero_pool.filling != NULL);
+}
+
+//zero_pool_drain - give every page of the pool back to the pmm, return the number of pages freed
+size_t
+zero_pool_drain(void) {
+    size_t n = 0;
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        while (zero_pool.nr > 0) {
+            list_entry_t *le = list_next(&(zero_pool.list));
+            list_del(le);
+            zero_pool.nr --;
+            free_page(le2page(le, page_link));
+            n ++;
+        }
+        if (zero_pool.filling != NULL) {
+            free_page(zero_pool.filling);
+            zero_pool.filling = NULL;
+            n ++;
+        }
+        zero_pool.refilling = 0;
+    }
+    local_intr_restore(intr_flag);
+    return n;
+}
+
+//zero_pool_refill - called by idleproc in cpu_idle, zero pages until the high watermark
+//                 - is reached or somebody else wants the CPU
+void
+zero_pool_refill(void) {
+    if (!zero_pool.refilling) {
+        if (zero_pool_nr() >= ZERO_POOL_LOW) {
+            return ;
+        }
+        zero_pool.refilling = 1;
+    }
+    while (!current->need_resched) {
+        if (zero_pool.filling == NULL) {
+            if (zero_pool.nr >= ZERO_POOL_HIGH || nr_free_pages() < ZERO_POOL_RESERVE) {
+                zero_pool.refilling = 0;
+                return ;
+            }
+            if ((zero_pool.filling = alloc_page()) == NULL) {
+                zero_pool.refilling = 0;
+                return ;
+            }
+            zero_pool.fill_off = 0;
+        }
+        memset(page2kva(zero_pool.filling) + zero_pool.fill_off, 0, ZERO_POOL_CHUNK);
+        if ((zero_pool.fill_off += ZERO_POOL_CHUNK) == PGSIZE) {
+            bool intr_flag;
+            local_intr_save(intr_flag);
+            {
+                list_add(&(zero_pool.list), &(zero_pool.filling->page_link));
+                zero_pool.nr ++;
+                zero_pool.filling = NULL;
+            }
+            local_intr_restore(intr_flag);
+        }
+    }
+}
+
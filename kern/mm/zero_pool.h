@@ -0,0 +1,21 @@
+// 预清零页池的接口定义
+#ifndef __KERN_MM_ZERO_POOL_H__
+#define __KERN_MM_ZERO_POOL_H__
+
+#include <defs.h>
+#include <memlayout.h>
+
+#define ZERO_POOL_LOW           16          // idle loop starts refilling below this many pages
+#define ZERO_POOL_HIGH          64          // and stops once the pool holds this many pages
+#define ZERO_POOL_RESERVE       256         // never refill when fewer free pages than this are left
+#define ZERO_POOL_CHUNK         512         // bytes zeroed between two need_resched checks
+
+void zero_pool_init(void);
+struct Page *zero_pool_get(void);
+struct Page *zero_pool_get_colour(size_t colour);
+size_t zero_pool_nr(void);
+size_t zero_pool_drain(void);
+void zero_pool_refill(void);
+
+#endif /* !__KERN_MM_ZERO_POOL_H__ */
+
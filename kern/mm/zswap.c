@@ -0,0 +1,234 @@
+// 内存中压缩交换区（zswap）：把冷的匿名页压缩后放进 slab，缺页时再解压换回
+#include <defs.h>
+#include <list.h>
+#include <string.h>
+#include <stdio.h>
+#include <assert.h>
+#include <error.h>
+#include <lz.h>
+#include <sync.h>
+#include <kmalloc.h>
+#include <pmm.h>
+#include <vmm.h>
+#include <proc.h>
+#include <thumips_tlb.h>
+#include <rmap.h>
+#include <zswap.h>
+
+/* The boards have no secondary storage, so instead of writing pages out we compress
+   them with lz_compress (libs/lz.c) and keep the result in a kmalloc'ed blob. The PTE of
+   a swapped-out page points to its blob (see PTE_ZSWAP in zswap.h); do_pgfault finds it
+   in the "not present but not zero" branch and calls zswap_swap_in.
+
+   Victims are chosen by a second-chance scan over the user pages of every process:
+   the TLB refill path in trap.c sets PTE_A, zswap_reclaim clears it on the first visit
+   and compresses the page if it has not been touched again by the next visit. Only
+   private pages (page_ref == 1) are taken, and never a page of the ksm stable tree.
+
+   A blob is only worth keeping if it fits in a kmalloc object of half a page, so pages
+   that do not compress at least 2:1 stay resident.
+
+   Reclaim runs when do_pgfault fails to get a page, and on every return to user mode
+   while fewer than ZSWAP_LOW pages are free (zswap_balance). Both are points where the
+   kernel holds no struct Page of a user mapping, so pages can be taken away safely.
+*/
+
+extern int swap_init_ok;
+
+struct zswap_blob {
+    int ref;                    // # of PTEs pointing to this blob (fork shares blobs)
+    size_t len;                 // length of the compressed data
+    uint8_t data[0];            // compressed data
+};
+
+#define ZSWAP_MAX_LEN           (PGSIZE / 2 - sizeof(struct zswap_blob))
+
+#define pte2blob(pte)           ((struct zswap_blob *)((pte) & ~PTE_ZSWAP))
+#define blob2pte(blob)          ((pte_t)(blob) | PTE_ZSWAP)
+
+// scratch buffer for lz_compress, zswap_reclaim runs with preemption disabled
+static uint8_t zswap_buf[ZSWAP_MAX_LEN];
+
+static struct {
+    size_t nr_stored;           // # of blobs
+    size_t nr_bytes;            // compressed bytes held by blobs
+    size_t nr_out;              // pages swapped out
+    size_t nr_in;               // pages swapped in
+    size_t nr_reject;           // pages that did not compress well enough
+} zswap_stat;
+
+static void check_zswap(void);
+
+//zswap_init - enable the swap branch of do_pgfault
+void
+zswap_init(void) {
+    check_zswap();
+    swap_init_ok = 1;
+    kprintf("zswap_init() succeeded!\n");
+}
+
+//zswap_entry_dup - one more PTE points to this entry (copy_range)
+void
+zswap_entry_dup(pte_t entry) {
+    assert(pte_is_zswap(entry));
+    pte2blob(entry)->ref ++;
+}
+
+//zswap_entry_free - drop one PTE reference of this entry, free the blob with the last one
+void
+zswap_entry_free(pte_t entry) {
+    assert(pte_is_zswap(entry));
+    struct zswap_blob *blob = pte2blob(entry);
+    assert(blob->ref > 0);
+    if (-- blob->ref == 0) {
+        zswap_stat.nr_stored --;
+        zswap_stat.nr_bytes -= blob->len;
+        kfree(blob);
+    }
+}
+
+//zswap_swap_out - compress the private page mapped by *ptep (la in pgdir) and replace the mapping by a zswap entry
+static int
+zswap_swap_out(pde_t *pgdir, uintptr_t la, pte_t *ptep) {
+    struct Page *page = pte2page(*ptep);
+    assert(page_ref(page) == 1);
+    size_t len = lz_compress(page2kva(page), PGSIZE, zswap_buf, ZSWAP_MAX_LEN);
+    if (len == 0) {
+        zswap_stat.nr_reject ++;
+        return -E_INVAL;
+    }
+    struct zswap_blob *blob;
+    if ((blob = kmalloc(sizeof(struct zswap_blob) + len)) == NULL) {
+        return -E_NO_MEM;
+    }
+    blob->ref = 1;
+    blob->len = len;
+    memcpy(blob->data, zswap_buf, len);
+    rmap_remove(page, pgdir, la);
+    *ptep = blob2pte(blob);
+    page_ref_dec(page);
+    free_page(page);
+    zswap_stat.nr_stored ++;
+    zswap_stat.nr_bytes += len;
+    zswap_stat.nr_out ++;
+    return 0;
+}
+
+//zswap_swap_in - decompress the page of the zswap entry *ptep and map it at la with perm
+int
+zswap_swap_in(pde_t *pgdir, uintptr_t la, pte_t *ptep, uint32_t perm) {
+    assert(pte_is_zswap(*ptep));
+    struct Page *page;
+    if ((page = alloc_pages_flags(1, ALLOC_COLOUR(va_colour(la)))) == NULL) {
+        if (zswap_reclaim(ZSWAP_BATCH) == 0 || (page = alloc_pages_flags(1, ALLOC_COLOUR(va_colour(la)))) == NULL) {
+            return -E_NO_MEM;
+        }
+    }
+    struct zswap_blob *blob = pte2blob(*ptep);
+    if (lz_decompress(blob->data, blob->len, page2kva(page), PGSIZE) != PGSIZE) {
+        panic("zswap: corrupted entry %08x at %08x.\n", *ptep, la);
+    }
+    // page_insert drops the zswap entry once the page is mapped; if it fails the entry stays
+    int ret;
+    if ((ret = page_insert(pgdir, page, la, perm)) != 0) {
+        free_page(page);
+        return ret;
+    }
+    zswap_stat.nr_in ++;
+    return 0;
+}
+
+//zswap_reclaim - compress at most n cold private user pages, return the # of pages freed
+size_t
+zswap_reclaim(size_t n) {
+    size_t freed = 0;
+    bool flush = 0;
+    list_entry_t *le = &proc_list;
+    // a process on proc_list may not go away under the walk
+    preempt_disable();
+    while (freed < n && (le = list_next(le)) != &proc_list) {
+        struct mm_struct *mm = le2proc(le, list_link)->mm;
+        if (mm == NULL || !try_down(&(mm->mm_sem))) {
+            continue ;
+        }
+        list_entry_t *list = &(mm->mmap_list), *vle = list;
+        while (freed < n && (vle = list_next(vle)) != list) {
+            struct vma_struct *vma = le2vma(vle, list_link);
+            uintptr_t la;
+            for (la = vma->vm_start; freed < n && la < vma->vm_end; la += PGSIZE) {
+                pte_t *ptep = get_pte(mm->pgdir, la, 0);
+                if (ptep == NULL) {
+                    la = ROUNDDOWN_2N(la + PTSIZE, PTSHIFT) - PGSIZE;
+                    continue ;
+                }
+                if (!(*ptep & PTE_P) || page_ref(pte2page(*ptep)) != 1 || PageKsm(pte2page(*ptep))) {
+                    continue ;
+                }
+                flush = 1;
+                if (*ptep & PTE_A) {
+                    *ptep &= ~PTE_A;
+                }
+                else if (zswap_swap_out(mm->pgdir, la, ptep) == 0) {
+                    freed ++;
+                }
+            }
+        }
+        up(&(mm->mm_sem));
+    }
+    if (flush) {
+        tlb_invalidate_all();
+    }
+    preempt_enable();
+    return freed;
+}
+
+//zswap_balance - called on return to user mode, reclaim a batch when memory runs low
+void
+zswap_balance(void) {
+    if (swap_init_ok && nr_free_pages() < ZSWAP_LOW) {
+        zswap_reclaim(ZSWAP_BATCH);
+    }
+}
+
+static void
+check_zswap(void) {
+    size_t nr_free_pages_store = nr_free_pages();
+    size_t slab_allocated_store = kallocated();
+
+    struct Page *p0 = alloc_page(), *p1;
+    assert(p0 != NULL);
+    int i, *data = page2kva(p0);
+    for (i = 0; i < PGSIZE / sizeof(int); i ++) {
+        data[i] = (i & 7);
+    }
+    assert(boot_pgdir[0] == 0);
+    assert(page_insert(boot_pgdir, p0, 0x0, PTE_U | PTE_W) == 0);
+    pte_t *ptep = get_pte(boot_pgdir, 0x0, 0), pte;
+    assert(zswap_swap_out(boot_pgdir, 0x0, ptep) == 0 && pte_is_zswap(pte = *ptep));
+    assert(zswap_stat.nr_stored == 1);
+
+    zswap_entry_dup(pte);
+    assert(pte2blob(pte)->ref == 2);
+    zswap_entry_free(pte);
+
+    assert((p1 = alloc_page()) != NULL);
+    struct zswap_blob *blob = pte2blob(pte);
+    assert(lz_decompress(blob->data, blob->len, page2kva(p1), PGSIZE) == PGSIZE);
+    data = page2kva(p1);
+    for (i = 0; i < PGSIZE / sizeof(int); i ++) {
+        assert(data[i] == (i & 7));
+    }
+    free_page(p1);
+    // unmapping a zswap entry frees its blob
+    page_remove(boot_pgdir, 0x0);
+    assert(zswap_stat.nr_stored == 0 && zswap_stat.nr_bytes == 0);
+    free_page(pa2page(PDE_ADDR(boot_pgdir[0])));
+    boot_pgdir[0] = 0;
+    zswap_stat.nr_out = 0;
+
+    assert(nr_free_pages_store == nr_free_pages());
+    assert(slab_allocated_store == kallocated());
+
+    kprintf("check_zswap() succeeded!\n");
+}
+
@@ -0,0 +1,28 @@
+// 内存中压缩交换区（zswap）的接口定义
+#ifndef __KERN_MM_ZSWAP_H__
+#define __KERN_MM_ZSWAP_H__
+
+#include <defs.h>
+#include <mmu.h>
+#include <memlayout.h>
+
+/* *
+ * A swapped-out PTE holds the kernel virtual address of its zswap blob with
+ * PTE_ZSWAP set and PTE_P clear. Blobs come from kmalloc and are at least
+ * 16-byte aligned, so the low bits of the address are free for the tag.
+ * */
+#define PTE_ZSWAP               0x002       // only meaningful when PTE_P is clear
+#define pte_is_zswap(pte)       (((pte) & (PTE_P | PTE_ZSWAP)) == PTE_ZSWAP)
+
+#define ZSWAP_LOW               128         // reclaim on return to user mode below this many free pages
+#define ZSWAP_BATCH             32          // max # of pages compressed by one reclaim pass
+
+void zswap_init(void);
+size_t zswap_reclaim(size_t n);
+void zswap_balance(void);
+int zswap_swap_in(pde_t *pgdir, uintptr_t la, pte_t *ptep, uint32_t perm);
+void zswap_entry_dup(pte_t entry);
+void zswap_entry_free(pte_t entry);
+
+#endif /* !__KERN_MM_ZSWAP_H__ */
+
@@ -13,8 +13,16 @@
 #include <assert.h>
 #include <unistd.h>
 #include <fs.h>
+#include <file.h>
 #include <vfs.h>
 #include <sysfile.h>
+#include <zero_pool.h>
+#include <ksm.h>
+#include <ras.h>
+#include <clock.h>
+#include <hrtimer.h>
+#include <softirq.h>
+#include <irqsoff.h>
 
 /* ------------- process/thread mechanism design&implementation -------------
 (an simplified Linux process/thread mechanism )
@@ -65,12 +73,22 @@ SYS_getpid      : get the process's pid
 // the process set's list
 list_entry_t proc_list;
 
-#define HASH_SHIFT          10
-#define HASH_LIST_SIZE      (1 << HASH_SHIFT)
-#define pid_hashfn(x)       (hash32(x, HASH_SHIFT))
+// hash_list follows nr_process: it doubles when there are more than 2 processes per bucket
+// and halves when fewer than 1 per 2 buckets, between 2^PID_HASH_MIN_SHIFT (static, never
+// freed) and 2^PID_HASH_MAX_SHIFT (kmalloc'ed) buckets. pids are handed out in order, so
+// the low bits spread them evenly.
+#define PID_HASH_MIN_SHIFT  6
+#define PID_HASH_MAX_SHIFT  11
+#define pid_hashfn(x)       ((x) & ((1 << hash_shift) - 1))
 
 // has list for process set based on pid
-static list_entry_t hash_list[HASH_LIST_SIZE];
+static list_entry_t hash_list_min[1 << PID_HASH_MIN_SHIFT];
+static list_entry_t *hash_list = hash_list_min;
+static int hash_shift = PID_HASH_MIN_SHIFT;
+
+// pid_map: bit pid is set from get_pid until the process is reaped in do_wait
+#define PID_MAP_WORDS       (MAX_PID / 32)
+static uint32_t pid_map[PID_MAP_WORDS];
 
 // 三个特殊的指针，一个指向空闲进程，一个指向最开始的init进程，最后一个指向当前进程（永远指向当前进程，就相当于进程的this指针）
 // idle proc —— 最初的进程“创建第0个内核线程idleproc”
@@ -83,6 +101,14 @@ struct proc_struct *current = NULL;
 
 static int nr_process = 0;
 
+// proc_cache: proc_structs of reaped processes that still own their kernel stack, linked by
+// list_link. do_fork takes from here before kmalloc and alloc_pages; proc_cache_shrink
+// gives everything back when memory runs out.
+#define PROC_CACHE_MAX              16
+
+static list_entry_t proc_cache;
+static int nr_proc_cache = 0;
+
 // ↓ 函数声明，函数体是汇编，写在entry.S里（且entry.S只有这一个函数）
 void kernel_thread_entry(void);
 // 同上，本体是汇编的函数声明，在kern/trap/exception.S里
@@ -97,13 +123,26 @@ void switch_to(struct context *from, struct context *to);
 // alloc_proc - alloc a proc_struct and init all fields of proc_struct
 static struct proc_struct *
 alloc_proc(void) {
-    struct proc_struct *proc = kmalloc(sizeof(struct proc_struct));
+    struct proc_struct *proc = NULL;
+    uintptr_t kstack = 0;
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    if (!list_empty(&proc_cache)) {
+        proc = le2proc(list_next(&proc_cache), list_link);
+        list_del(&(proc->list_link));
+        nr_proc_cache --;
+        kstack = proc->kstack;
+    }
+    local_intr_restore(intr_flag);
+    if (proc == NULL) {
+        proc = kmalloc(sizeof(struct proc_struct));
+    }
     if (proc != NULL) {
       //LAB4:EXERCISE1 2009010989
       proc->state = PROC_UNINIT;
       proc->pid = -1;
       proc->runs = 0;
-      proc->kstack = 0;
+      proc->kstack = kstack;   // a cached proc_struct comes with its kernel stack
       proc->need_resched = 0;
       proc->parent = NULL;
       proc->mm = NULL;
@@ -118,8 +157,25 @@ alloc_proc(void) {
       list_init(&(proc->run_link));
       list_init(&(proc->list_link));
       proc->time_slice = 0;
+      proc->lab6_priority = 0;
+      proc->mlfq_level = 0;
+      proc->mlfq_gen = 0;
+      proc->nice = 0;
+      proc->policy = SCHED_NORMAL;
+      proc->rt_priority = 0;
+      proc->vruntime = proc->fair_charged = 0;
+      proc->nr_wakeups = proc->max_delay = proc->delay_stamp = 0;
+      memset(&(proc->run_delay), 0, sizeof(proc->run_delay));
+      proc->woken = proc->slice_expired = 0;
+      proc->max_wakeup = 0;
+      memset(proc->wakeup_hist, 0, sizeof(proc->wakeup_hist));
+      memset(proc->nr_switch, 0, sizeof(proc->nr_switch));
       proc->cptr = proc->yptr = proc->optr = NULL;
       proc->fs_struct = NULL;  //初始化fs中的进程控制结构
+      list_init(&(proc->thread_group));
+      memset(proc->times, 0, sizeof(proc->times));
+      proc->nvcsw = proc->nivcsw = 0;
+      proc->preempt_count = 0;    // a new process starts in forkret, outside of schedule()
     }
     return proc;
 }
@@ -167,40 +223,46 @@ remove_links(struct proc_struct *proc) {
     nr_process --;
 }
 
-// 给进程分配唯一pid，我记得lab几有问题问过算法……
-// get_pid - alloc a unique pid for process
+// pid_map_find - the first free pid in [from, to), -1 if there is none.
+//              - a word with all 32 pids in use is skipped at once
 static int
-get_pid(void) {
-    static_assert(MAX_PID > MAX_PROCESS);
-    struct proc_struct *proc;
-    list_entry_t *list = &proc_list, *le;
-    static int next_safe = MAX_PID, last_pid = MAX_PID;
-    if (++ last_pid >= MAX_PID) {
-        last_pid = 1;
-        goto inside;
-    }
-    if (last_pid >= next_safe) {
-    inside:
-        next_safe = MAX_PID;
-    repeat:
-        le = list;
-        while ((le = list_next(le)) != list) {
-            proc = le2proc(le, list_link);
-            if (proc->pid == last_pid) {
-                if (++ last_pid >= next_safe) {
-                    if (last_pid >= MAX_PID) {
-                        last_pid = 1;
-                    }
-                    next_safe = MAX_PID;
-                    goto repeat;
-                }
-            }
-            else if (proc->pid > last_pid && next_safe > proc->pid) {
-                next_safe = proc->pid;
+pid_map_find(int from, int to) {
+    while (from < to) {
+        // the pids below from in its word count as used
+        uint32_t word = pid_map[from >> 5] | ((1u << (from & 31)) - 1);
+        if (word != 0xFFFFFFFF) {
+            int pid = from & ~31;
+            while (word & 1) {
+                word >>= 1, pid ++;
             }
+            return (pid < to) ? pid : -1;
         }
+        from = (from & ~31) + 32;
     }
-    return last_pid;
+    return -1;
+}
+
+// 给进程分配唯一pid：在 pid_map 中从上次分配的 pid 之后找第一个空闲位，到 MAX_PID 后回到 1
+// get_pid - alloc a unique pid for process
+static int
+get_pid(void) {
+    static_assert(MAX_PID > MAX_PROCESS && MAX_PID % 32 == 0);
+    static int last_pid = 0;
+    int pid;
+    if ((pid = pid_map_find(last_pid + 1, MAX_PID)) < 0) {
+        pid = pid_map_find(1, last_pid + 1);
+    }
+    // do_fork checks nr_process < MAX_PROCESS first, so there is always a free one
+    assert(pid > 0);
+    pid_map[pid >> 5] |= 1u << (pid & 31);
+    return (last_pid = pid);
+}
+
+// put_pid - free the pid of a reaped process
+static void
+put_pid(int pid) {
+    assert(pid_map[pid >> 5] & (1u << (pid & 31)));
+    pid_map[pid >> 5] &= ~(1u << (pid & 31));
 }
 
 // 给某个进程cpu，让它真正跑起来
@@ -215,6 +277,9 @@ proc_run(struct proc_struct *proc) {
         local_intr_save(intr_flag);
         {
           //panic("unimpl");
+            cputime_switch(CPUTIME_SYS);
+            prev->preempt_count = preempt_count;
+            preempt_count = next->preempt_count;
             current = proc;
             //load_sp(next->kstack + KSTACKSIZE);
             lcr3(next->cr3);
@@ -230,6 +295,11 @@ proc_run(struct proc_struct *proc) {
 //       after switch_to, the current proc will execute here.
 static void
 forkret(void) {
+    // a new process leaves the kernel here, not through the end of mips_trap
+    cputime_switch(trap_in_kernel(current->tf) ? CPUTIME_SYS : CPUTIME_USER);
+    if (IRQSOFF_TRACE && (current->tf->tf_status & ST0_IE)) {
+        irqsoff_stop((uintptr_t)forkret + 8);   // shown like a return address
+    }
     forkrets(current->tf);
 }
 
@@ -246,6 +316,56 @@ unhash_proc(struct proc_struct *proc) {
     list_del(&(proc->hash_link));
 }
 
+// pid_hash_resize - rehash all processes into 2^shift buckets, keep the old table if out of memory
+//                 - or if another resize got in while kmalloc slept or this process was preempted
+static void
+pid_hash_resize(int shift) {
+    int oshift = hash_shift;
+    list_entry_t *list = hash_list_min, *old;
+    if (shift != PID_HASH_MIN_SHIFT && (list = kmalloc(sizeof(list_entry_t) << shift)) == NULL) {
+        return ;
+    }
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        if (hash_shift != oshift) {
+            // dropped; hash_list_min may be the live table, so it is neither cleared nor freed
+            old = list;
+        }
+        else {
+            old = hash_list;
+            int i;
+            for (i = 0; i < (1 << shift); i ++) {
+                list_init(list + i);
+            }
+            hash_list = list, hash_shift = shift;
+            list_entry_t *le = &proc_list;
+            while ((le = list_next(le)) != &proc_list) {
+                hash_proc(le2proc(le, list_link));
+            }
+        }
+    }
+    local_intr_restore(intr_flag);
+    if (old != hash_list_min) {
+        kfree(old);
+    }
+}
+
+// pid_hash_fit - resize hash_list if nr_process has left [buckets / 2, buckets * 2]
+static void
+pid_hash_fit(void) {
+    int shift = hash_shift;
+    while (shift < PID_HASH_MAX_SHIFT && nr_process > (2 << shift)) {
+        shift ++;
+    }
+    while (shift > PID_HASH_MIN_SHIFT && nr_process < (1 << shift) / 2) {
+        shift --;
+    }
+    if (shift != hash_shift) {
+        pid_hash_resize(shift);
+    }
+}
+
 // 遍历hash_list，找到对应pid的进程
 // find_proc - find proc frome proc hash_list according to pid
 struct proc_struct *
@@ -284,35 +404,133 @@ kernel_thread(int (*fn)(void *), void *arg, uint32_t clone_flags) {
     return do_fork(clone_flags | CLONE_VM, 0, &tf);
 }
 
+/* *
+ * KSTACK_DEPTH_CHECK: a new kernel stack is filled with KSTACK_MAGIC, and when it is freed
+ * the lowest word that is no longer KSTACK_MAGIC tells how deep the process went.
+ * kstack_max_depth is the deepest seen since boot; it must stay well below PGSIZE before
+ * KSTACKPAGE (memlayout.h) is lowered to 1. A stack whose bottom word is gone has overflowed.
+ * */
+#define KSTACK_DEPTH_CHECK          0               // 1: measure the kernel stack depth, at a cost to fork and exit
+#define KSTACK_MAGIC                0x6b73746b      // "ktsk"
+
+static size_t kstack_max_depth = 0;
+static char kstack_max_name[PROC_NAME_LEN + 1];
+
 // 用alloc_pages给进程申请一页，当做kernel stack（proc->kstack）
 // setup_kstack - alloc pages with size KSTACKPAGE as process kernel stack
 static int
 setup_kstack(struct proc_struct *proc) {
+    if (proc->kstack != 0) {
+        // from proc_cache, free_proc has already refilled it with KSTACK_MAGIC
+        return 0;
+    }
     struct Page *page = alloc_pages(KSTACKPAGE);
     if (page != NULL) {
         proc->kstack = (uintptr_t)page2kva(page);
+        if (KSTACK_DEPTH_CHECK) {
+            uint32_t *p = (uint32_t *)proc->kstack;
+            int i;
+            for (i = 0; i < KSTACKSIZE / sizeof(uint32_t); i ++) {
+                p[i] = KSTACK_MAGIC;
+            }
+        }
         return 0;
     }
     return -E_NO_MEM;
 }
 
+// kstack_depth - the # of bytes of the kernel stack of proc that have been written
+static size_t
+kstack_depth(struct proc_struct *proc) {
+    uint32_t *p = (uint32_t *)proc->kstack;
+    int i;
+    for (i = 0; i < KSTACKSIZE / sizeof(uint32_t) && p[i] == KSTACK_MAGIC; i ++) {
+        /* do nothing */ ;
+    }
+    if (i == 0) {
+        panic("kernel stack of process %d (%s) overflowed.\n", proc->pid, proc->name);
+    }
+    return KSTACKSIZE - i * sizeof(uint32_t);
+}
+
+// kstack_account - record how deep the kernel stack of proc went, return the depth
+static size_t
+kstack_account(struct proc_struct *proc) {
+    size_t depth = kstack_depth(proc);
+    if (depth > kstack_max_depth) {
+        kstack_max_depth = depth;
+        memcpy(kstack_max_name, proc->name, sizeof(kstack_max_name));
+    }
+    return depth;
+}
+
 // 与↑呼应，释放proc->kstack
 // put_kstack - free the memory space of process kernel stack
 static void
 put_kstack(struct proc_struct *proc) {
+    if (KSTACK_DEPTH_CHECK) {
+        kstack_account(proc);
+    }
     free_pages(kva2page((void *)(proc->kstack)), KSTACKPAGE);
 }
 
+// free_proc - free a proc_struct and its kernel stack (if any), or keep both in proc_cache
+static void
+free_proc(struct proc_struct *proc) {
+    bool intr_flag;
+    if (proc->kstack != 0 && nr_proc_cache < PROC_CACHE_MAX) {
+        if (KSTACK_DEPTH_CHECK) {
+            // only the part of the stack that was used has to be refilled
+            size_t depth = kstack_account(proc);
+            uint32_t *p = (uint32_t *)(proc->kstack + KSTACKSIZE - depth);
+            int i;
+            for (i = 0; i < depth / sizeof(uint32_t); i ++) {
+                p[i] = KSTACK_MAGIC;
+            }
+        }
+        local_intr_save(intr_flag);
+        list_add(&proc_cache, &(proc->list_link));
+        nr_proc_cache ++;
+        local_intr_restore(intr_flag);
+        return ;
+    }
+    if (proc->kstack != 0) {
+        put_kstack(proc);
+    }
+    kfree(proc);
+}
+
+// proc_cache_shrink - free all cached proc_structs and kernel stacks, return the # of pages freed
+size_t
+proc_cache_shrink(void) {
+    size_t n = 0;
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        while (!list_empty(&proc_cache)) {
+            struct proc_struct *proc = le2proc(list_next(&proc_cache), list_link);
+            list_del(&(proc->list_link));
+            nr_proc_cache --;
+            free_pages(kva2page((void *)(proc->kstack)), KSTACKPAGE);
+            kfree(proc);
+            n += KSTACKPAGE;
+        }
+    }
+    local_intr_restore(intr_flag);
+    return n;
+}
+
 // ↓ 这俩一个申请一个释放pgdir
 // setup_pgdir - alloc one page as PDT
 static int
 setup_pgdir(struct mm_struct *mm) {
     struct Page *page;
-    if ((page = alloc_page()) == NULL) {
+    // boot_pgdir is cleared at the end of pmm_init and holds no mappings afterwards,
+    // so a zeroed page is the same as a copy of it
+    if ((page = alloc_zeroed_page()) == NULL) {
         return -E_NO_MEM;
     }
     pde_t *pgdir = page2kva(page);
-    memcpy(pgdir, boot_pgdir, PGSIZE);
     //panic("unimpl");
     //pgdir[PDX(VPT)] = PADDR(pgdir) | PTE_P | PTE_W;
     mm->pgdir = pgdir;
@@ -332,8 +550,8 @@ static int
 copy_mm(uint32_t clone_flags, struct proc_struct *proc) {
     struct mm_struct *mm, *oldmm = current->mm;
 
-    /* current is a kernel thread */
-    if (oldmm == NULL) {
+    /* current is a kernel thread, or the child gets its mm from spawn_main */
+    if (oldmm == NULL || (clone_flags & CLONE_SPAWN)) {
         return 0;
     }
     if (clone_flags & CLONE_VM) {
@@ -351,7 +569,9 @@ copy_mm(uint32_t clone_flags, struct proc_struct *proc) {
 
     lock_mm(oldmm);
     {
-        ret = dup_mmap(mm, oldmm);
+        if ((ret = dup_mmap(mm, oldmm)) == 0) {
+            ret = dup_ras(mm, oldmm);
+        }
     }
     unlock_mm(oldmm);
 
@@ -394,6 +614,11 @@ copy_fs(uint32_t clone_flags, struct proc_struct *proc) {
     struct fs_struct *fs_struct, *old_fs_struct = current->fs_struct;
     assert(old_fs_struct != NULL);
 
+    /* spawn_main installs the fs_struct do_spawn has made for the child */
+    if (clone_flags & CLONE_SPAWN) {
+        return 0;
+    }
+
     if (clone_flags & CLONE_FS) {
         fs_struct = old_fs_struct;
         goto good_fs_struct;
@@ -459,13 +684,17 @@ do_fork(uint32_t clone_flags, uintptr_t stack, struct trapframe *tf) {
     }
 
     proc->parent = current;
+    proc->lab6_priority = current->lab6_priority;
+    proc->nice = current->nice;
+    proc->policy = current->policy;
+    proc->rt_priority = current->rt_priority;
 
     if(setup_kstack(proc)){
         goto bad_fork_cleanup_proc;
     }
     //LAB8:EXERCISE2 2009010989 HINT:how to copy the fs in parent's proc_struct?
     if (copy_fs(clone_flags, proc) != 0) {
-        goto bad_fork_cleanup_kstack;
+        goto bad_fork_cleanup_proc;
     }
     if (copy_mm(clone_flags, proc)){
         goto bad_fork_cleanup_fs;
@@ -473,12 +702,19 @@ do_fork(uint32_t clone_flags, uintptr_t stack, struct trapframe *tf) {
 
     copy_thread(proc, (uint32_t)stack, tf);
 
-    proc->pid = get_pid();
-    hash_proc(proc);
-
-
-    //list_add(&proc_list, &(proc->list_link));
-    set_links(proc);
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        if (clone_flags & CLONE_THREAD) {
+            list_add_before(&(current->thread_group), &(proc->thread_group));
+        }
+        proc->pid = get_pid();
+        hash_proc(proc);
+        //list_add(&proc_list, &(proc->list_link));
+        set_links(proc);
+    }
+    local_intr_restore(intr_flag);
+    pid_hash_fit();
 
     wakeup_proc(proc);
 
@@ -489,10 +725,8 @@ fork_out:
 
 bad_fork_cleanup_fs:
     put_fs(proc);
-bad_fork_cleanup_kstack:
-    put_kstack(proc);
 bad_fork_cleanup_proc:
-    kfree(proc);
+    free_proc(proc);
     goto fork_out;
 }
 
@@ -515,22 +749,24 @@ do_exit(int error_code) {
     struct mm_struct *mm = current->mm;
     if (mm != NULL) {
         lcr3(boot_cr3);
+        // out of sight of zswap_reclaim and ksm_scan before it is torn down
+        current->mm = NULL;
         if (mm_count_dec(mm) == 0) {
             exit_mmap(mm);
             put_pgdir(mm);
             mm_destroy(mm);
         }
-        current->mm = NULL;
     }
     put_fs(current); //in LAB8
-    current->state = PROC_ZOMBIE;
-    current->exit_code = error_code;
 
 	
     bool intr_flag;
     struct proc_struct *proc;
     local_intr_save(intr_flag);
     {
+        list_del_init(&(current->thread_group));
+        current->state = PROC_ZOMBIE;
+        current->exit_code = error_code;
         proc = current->parent;
         if (proc->wait_state == WT_CHILD) {
             wakeup_proc(proc);
@@ -558,6 +794,105 @@ do_exit(int error_code) {
     panic("do_exit will not return!! %d.\n", current->pid);
 }
 
+// thread_group_kill - ask every other thread in the group of proc to exit
+static void
+thread_group_kill(struct proc_struct *proc) {
+    list_entry_t *list = &(proc->thread_group), *le = list;
+    while ((le = list_next(le)) != list) {
+        struct proc_struct *thread = le2proc(le, thread_group);
+        if (!(thread->flags & PF_EXITING)) {
+            thread->flags |= PF_EXITING;
+            if (thread->wait_state & WT_INTERRUPTED) {
+                wakeup_proc(thread);
+            }
+        }
+    }
+}
+
+// do_exit_group - called by sys_exit: the other threads of current exit when they next
+//               - return to user mode, and current exits now
+int
+do_exit_group(int error_code) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    thread_group_kill(current);
+    local_intr_restore(intr_flag);
+    return do_exit(error_code);
+}
+
+/* *
+ * do_clone - called by sys_clone: create a child that starts at entry(arg) in user mode
+ * on the stack given by the caller. CLONE_THREAD puts it in the thread group of current,
+ * which shares the mm and the files, so it needs CLONE_VM and CLONE_FS too. The child is
+ * a child of current for do_wait, which is how a thread is joined.
+ * */
+int
+do_clone(uint32_t clone_flags, uintptr_t stack, uintptr_t entry, uintptr_t arg) {
+    if (clone_flags & ~(CLONE_VM | CLONE_THREAD | CLONE_FS)) {
+        return -E_INVAL;
+    }
+    if ((clone_flags & CLONE_THREAD) && (clone_flags & (CLONE_VM | CLONE_FS)) != (CLONE_VM | CLONE_FS)) {
+        return -E_INVAL;
+    }
+    if (current->mm == NULL || stack == 0 || !USER_ACCESS(entry, entry + sizeof(uint32_t))) {
+        return -E_INVAL;
+    }
+    struct trapframe tf = *(current->tf);
+    tf.tf_epc = entry;
+    tf.tf_regs.reg_r[MIPS_REG_A0] = arg;
+    return do_fork(clone_flags, stack, &tf);
+}
+
+/* *
+ * The argv strings of an exec are packed back to back in one kmalloc'ed buffer sized to
+ * their real lengths: kargv[0] is the start of the buffer and kargv[i] points into it.
+ * load_icode copies the buffer to the top of the user stack in one piece.
+ * */
+static void
+put_kargv(int argc, char **kargv) {
+    if (argc > 0) {
+        kfree(kargv[0]);
+    }
+}
+
+// kargv_size - the bytes of the packed argv strings, the last '\0' included
+static size_t
+kargv_size(int argc, char **kargv) {
+    return kargv[argc - 1] + strlen(kargv[argc - 1]) + 1 - kargv[0];
+}
+
+static int
+copy_kargv(struct mm_struct *mm, int argc, char **kargv, const char **argv) {
+    int i, len;
+    size_t size = 0;
+    if (!user_mem_check(mm, (uintptr_t)argv, sizeof(const char *) * argc, 0)) {
+        return -E_INVAL;
+    }
+    for (i = 0; i < argc; i ++) {
+        if ((len = strnlen_user(mm, argv[i], EXEC_MAX_ARG_LEN + 1)) < 0) {
+            return -E_INVAL;
+        }
+        if ((size += len + 1) > EXEC_MAX_ARGS_SIZE) {
+            return -E_TOO_BIG;
+        }
+    }
+
+    char *base, *buffer;
+    if ((base = buffer = kmalloc(size)) == NULL) {
+        return -E_NO_MEM;
+    }
+    for (i = 0; i < argc; i ++) {
+        // the strings were measured above, a string that has grown since does not fit
+        if (!copy_string(mm, buffer, argv[i], size - (buffer - base))) {
+            kfree(base);
+            return -E_INVAL;
+        }
+        kargv[i] = buffer;
+        buffer += strlen(buffer) + 1;
+    }
+    return 0;
+}
+
 //load_icode_read is used by load_icode in LAB8
 static int
 load_icode_read(int fd, void *buf, size_t len, off_t offset) {
@@ -657,7 +992,7 @@ load_icode(int fd, int argc, char **kargv) {
       // 复制数据段和代码段
       end = ph->p_va + ph->p_filesz; // 计算数据段和代码段终止地址
       while (start < end) {
-        if ((page = pgdir_alloc_page(mm->pgdir, la, perm)) == NULL) {
+        if ((page = pgdir_alloc_page_flags(mm->pgdir, la, perm, ALLOC_COLOURED)) == NULL) {
           ret = -E_NO_MEM;
           goto bad_cleanup_mmap;
         }
@@ -687,8 +1022,9 @@ load_icode(int fd, int argc, char **kargv) {
         assert((end < la && start == end) || (end >= la && start == la));
       }
 
+      // BSS 页直接从预清零页池中取，无需再 memset
       while (start < end) {
-        if ((page = pgdir_alloc_page(mm->pgdir, la, perm)) == NULL) {
+        if ((page = pgdir_alloc_page_flags(mm->pgdir, la, perm, ALLOC_ZEROED | ALLOC_COLOURED)) == NULL) {
           ret = -E_NO_MEM;
           goto bad_cleanup_mmap;
         }
@@ -696,8 +1032,6 @@ load_icode(int fd, int argc, char **kargv) {
         if (end < la) {
           size -= la - end;
         }
-        //每次操作size大小的块
-        memset(page2kva(page) + off, 0, size);
         start += size;
       }
     }
@@ -727,15 +1061,18 @@ load_icode(int fd, int argc, char **kargv) {
     tf->tf_eip = elf->e_entry;
     tf->tf_eflags = FL_IF;
 #endif
-    // 处理用户栈中传入的参数，其中argc对应参数个数，uargv[]对应参数的具体内容的地址
-	uintptr_t stacktop = USTACKTOP - argc * PGSIZE;
-    char **uargv = (char **)(stacktop - argc * sizeof(char *));
+    // 处理用户栈中传入的参数：字符串紧凑地放在栈顶，下面是 uargv[] 指针数组（以 NULL 结尾）
+    size_t size = kargv_size(argc, kargv);
+    uintptr_t stacktop = USTACKTOP - ROUNDUP_2N(size, 2);
+    char **uargv = (char **)(stacktop - (argc + 1) * sizeof(char *));
     int i;
-    for (i = 0; i < argc; i ++) { // 将所有参数取出来放置uargv
-        uargv[i] = strcpy((char *)(stacktop + i * PGSIZE), kargv[i]);
+    memcpy((void *)stacktop, kargv[0], size);
+    for (i = 0; i < argc; i ++) {
+        uargv[i] = (char *)stacktop + (kargv[i] - kargv[0]);
     }
-    //stacktop = (uintptr_t)uargv - sizeof(int);
-    //*(int *)stacktop = argc;
+    uargv[argc] = NULL;
+    // the o32 ABI lets main spill its 4 register arguments above sp
+    stacktop = ROUNDDOWN_2N((uintptr_t)uargv - 4 * sizeof(uint32_t), 3);
 
     // 设置进程的中断帧
     struct trapframe *tf = current->tf;
@@ -743,7 +1080,7 @@ load_icode(int fd, int argc, char **kargv) {
     memset(tf, 0, sizeof(struct trapframe));
 
     tf->tf_epc = elf->e_entry;
-    tf->tf_regs.reg_r[MIPS_REG_SP] = USTACKTOP;
+    tf->tf_regs.reg_r[MIPS_REG_SP] = stacktop;
     uint32_t status = read_c0_status();
     status &= ~ST0_KSU;
     status |= KSU_USER;
@@ -767,38 +1104,47 @@ bad_mm:
     goto out;
 }
 
-// this function isn't very correct in LAB8
-static void
-put_kargv(int argc, char **kargv) {
-    while (argc > 0) {
-        kfree(kargv[-- argc]);
-    }
-}
-
+/* *
+ * exec_kargv - the second half of do_execve and spawn_main: close the files, drop the
+ * memory of current and load the program at path. kargv is freed. path must be in the
+ * user space of current, or in the kernel if current has no mm. Exits on failure.
+ * */
 static int
-copy_kargv(struct mm_struct *mm, int argc, char **kargv, const char **argv) {
-    int i, ret = -E_INVAL;
-    if (!user_mem_check(mm, (uintptr_t)argv, sizeof(const char *) * argc, 0)) {
-        return ret;
+exec_kargv(const char *local_name, const char *path, int argc, char **kargv) {
+    struct mm_struct *mm = current->mm;
+    int fd, ret;
+    // the new program runs alone, the other threads of current go away with the old one
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    thread_group_kill(current);
+    list_del_init(&(current->thread_group));
+    local_intr_restore(intr_flag);
+    fs_closeall(current->fs_struct);
+
+    /* sysfile_open will check the first argument path, thus we have to use a user-space pointer, and argv[0] may be incorrect */	
+    if ((ret = fd = sysfile_open(path, O_RDONLY)) < 0) {
+        goto execve_exit;
     }
-    for (i = 0; i < argc; i ++) {
-        char *buffer;
-        if ((buffer = kmalloc(EXEC_MAX_ARG_LEN + 1)) == NULL) {
-            goto failed_nomem;
-        }
-        if (!copy_string(mm, buffer, argv[i], EXEC_MAX_ARG_LEN + 1)) {
-            kfree(buffer);
-            goto failed_cleanup;
+    if (mm != NULL) {
+        lcr3(boot_cr3);
+        current->mm = NULL;
+        if (mm_count_dec(mm) == 0) {
+            exit_mmap(mm);
+            put_pgdir(mm);
+            mm_destroy(mm);
         }
-        kargv[i] = buffer;
     }
+    if ((ret = load_icode(fd, argc, kargv)) != 0) {
+        goto execve_exit;
+    }
+    put_kargv(argc, kargv);
+    set_proc_name(current, local_name);
     return 0;
 
-failed_nomem:
-    ret = -E_NO_MEM;
-failed_cleanup:
-    put_kargv(i, kargv);
-    return ret;
+execve_exit:
+    put_kargv(argc, kargv);
+    do_exit(ret);
+    panic("already exit: %e.\n", ret);
 }
 
 // 用 load_icode 把 ELF 文件加载到内存里，load_icode 修改了 eip 指针，接下来就会执行 ELF 了。
@@ -836,34 +1182,85 @@ do_execve(const char *name, int argc, const char **argv) {
     }
     path = argv[0];
     unlock_mm(mm);
-    fs_closeall(current->fs_struct);
+    return exec_kargv(local_name, path, argc, kargv);
+}
 
-    /* sysfile_open will check the first argument path, thus we have to use a user-space pointer, and argv[0] may be incorrect */	
-    int fd;
-    if ((ret = fd = sysfile_open(path, O_RDONLY)) < 0) {
-        goto execve_exit;
+/* *
+ * do_spawn starts a program in a new child without copying the parent first: the child
+ * begins as a kernel thread with no mm (CLONE_SPAWN), and spawn_main builds its memory
+ * straight from load_icode. The parent only copies argv and the two files the child
+ * gets as stdin / stdout, which are handed over in a spawn_args.
+ * */
+struct spawn_args {
+    int argc;
+    char *kargv[EXEC_MAX_ARG_NUM];
+    struct fs_struct *fs_struct;    // the files of the child, not counted until spawn_main
+};
+
+static int
+spawn_main(void *arg) {
+    struct spawn_args *sa = (struct spawn_args *)arg;
+    int argc = sa->argc;
+    char *kargv[EXEC_MAX_ARG_NUM], local_name[PROC_NAME_LEN + 1];
+    memcpy(kargv, sa->kargv, argc * sizeof(char *));
+    snprintf(local_name, sizeof(local_name), "%s", kargv[0]);
+
+    assert(current->fs_struct == NULL && current->mm == NULL);
+    fs_count_inc(sa->fs_struct);
+    current->fs_struct = sa->fs_struct;
+    kfree(sa);
+
+    // load_icode wrote current->tf above this stack, return to user mode through it
+    exec_kargv(local_name, kargv[0], argc, kargv);
+    cputime_switch(CPUTIME_USER);
+    forkrets(current->tf);
+    panic("spawn_main: forkrets returned.\n");
+}
+
+/* *
+ * do_spawn - create a child running the program argv[0] with argv, its fd 0 / 1 are
+ *          - dup'ed from fd_in / fd_out of current (-1: closed). Return the pid of the child.
+ * */
+int
+do_spawn(int argc, const char **argv, int fd_in, int fd_out) {
+    struct mm_struct *mm = current->mm;
+    if (!(argc >= 1 && argc <= EXEC_MAX_ARG_NUM)) {
+        return -E_INVAL;
     }
-    if (mm != NULL) {
-        lcr3(boot_cr3);
-        if (mm_count_dec(mm) == 0) {
-            exit_mmap(mm);
-            put_pgdir(mm);
-            mm_destroy(mm);
-        }
-        current->mm = NULL;
+
+    int ret = -E_NO_MEM;
+    struct spawn_args *sa;
+    if ((sa = kmalloc(sizeof(struct spawn_args))) == NULL) {
+        goto bad_spawn;
     }
-    ret= -E_NO_MEM;;
-    if ((ret = load_icode(fd, argc, kargv)) != 0) {
-        goto execve_exit;
+    if ((sa->fs_struct = fs_create()) == NULL) {
+        goto bad_spawn_cleanup_sa;
+    }
+    if ((ret = dup_fs_stdio(sa->fs_struct, current->fs_struct, fd_in, fd_out)) != 0) {
+        goto bad_spawn_cleanup_fs;
     }
-    put_kargv(argc, kargv);
-    set_proc_name(current, local_name);
-    return 0;
 
-execve_exit:
-    put_kargv(argc, kargv);
-    do_exit(ret);
-    panic("already exit: %e.\n", ret);
+    lock_mm(mm);
+    ret = copy_kargv(mm, argc, sa->kargv, argv);
+    unlock_mm(mm);
+    if (ret != 0) {
+        goto bad_spawn_cleanup_fs;
+    }
+    sa->argc = argc;
+
+    if ((ret = kernel_thread(spawn_main, sa, CLONE_SPAWN)) < 0) {
+        goto bad_spawn_cleanup_kargv;
+    }
+    return ret;
+
+bad_spawn_cleanup_kargv:
+    put_kargv(argc, sa->kargv);
+bad_spawn_cleanup_fs:
+    fs_destroy(sa->fs_struct);
+bad_spawn_cleanup_sa:
+    kfree(sa);
+bad_spawn:
+    return ret;
 }
 
 // do_yield - ask the scheduler to reschedule
@@ -893,6 +1290,8 @@ do_wait(int pid, int *code_store) {
   bool intr_flag, haskid;
 repeat:
   haskid = 0;
+  // a child that exits between the scan and the sleep would wake nobody
+  local_intr_save(intr_flag);
   if (pid != 0) {
     proc = find_proc(pid);
         if (proc != NULL && proc->parent == current) {
@@ -914,12 +1313,14 @@ repeat:
     if (haskid) {
         current->state = PROC_SLEEPING;
         current->wait_state = WT_CHILD;
+        local_intr_restore(intr_flag);
         schedule();
         if (current->flags & PF_EXITING) {
             do_exit(-E_KILLED);
         }
         goto repeat;
     }
+    local_intr_restore(intr_flag);
     return -E_BAD_PROC;
 
 found:
@@ -929,14 +1330,14 @@ found:
     if (code_store != NULL) {
         *code_store = proc->exit_code;
     }
-    local_intr_save(intr_flag);
     {
         unhash_proc(proc);
         remove_links(proc);
+        put_pid(proc->pid);
     }
     local_intr_restore(intr_flag);
-    put_kstack(proc);
-    kfree(proc);
+    pid_hash_fit();
+    free_proc(proc);
     return 0;
 }
 
@@ -946,69 +1347,178 @@ found:
 int
 do_kill(int pid) {
     struct proc_struct *proc;
+    bool intr_flag;
+    int ret = -E_INVAL;
+    local_intr_save(intr_flag);
     if ((proc = find_proc(pid)) != NULL) {
+        ret = -E_KILLED;
         if (!(proc->flags & PF_EXITING)) {
             proc->flags |= PF_EXITING;
             if (proc->wait_state & WT_INTERRUPTED) {
                 wakeup_proc(proc);
             }
-            return 0;
+            // a thread is killed with its whole group
+            thread_group_kill(proc);
+            ret = 0;
         }
-        return -E_KILLED;
     }
-    return -E_INVAL;
+    local_intr_restore(intr_flag);
+    return ret;
 }
 
-// 系统调用SYS_exec
-// kernel_execve - do SYS_exec syscall to exec a user program called by user_main kernel_thread
-static int
-kernel_execve(const char *name, const char **argv) {
-    int argc = 0, ret;
-    while (argv[argc] != NULL) {
-        argc ++;
+static void
+procinfo_fill(struct procinfo *info, struct proc_struct *proc) {
+    static const char state_char[] = {
+        [PROC_UNINIT] 'U', [PROC_SLEEPING] 'S', [PROC_RUNNABLE] 'R', [PROC_ZOMBIE] 'Z',
+    };
+    info->pid = proc->pid;
+    info->ppid = (proc->parent != NULL) ? proc->parent->pid : -1;
+    info->runs = proc->runs;
+    info->nvcsw = proc->nvcsw, info->nivcsw = proc->nivcsw;
+    memcpy(info->times, proc->times, sizeof(info->times));
+    info->state = state_char[proc->state];
+    snprintf(info->name, sizeof(info->name), "%s", proc->name);
+}
+
+/* *
+ * do_procinfo - called by sys_procinfo: copy a snapshot of at most n processes, idle
+ * first, to buf in user space. Return the number copied.
+ * */
+int
+do_procinfo(struct procinfo *buf, int n) {
+    static_assert(sizeof(struct procinfo) == 64);
+    struct mm_struct *mm = current->mm;
+    if (n <= 0) {
+        return -E_INVAL;
     }
-    //panic("unimpl");
-    asm volatile(
-      "la $v0, %1;\n" /* syscall no. */
-      "move $a0, %2;\n"
-      "move $a1, %3;\n"
-      "move $a2, %4;\n"
-      "move $a3, %5;\n"
-      "syscall;\n"
-      "nop;\n"
-      "move %0, $v0;\n"
-      : "=r"(ret)
-      : "i"(SYSCALL_BASE+SYS_exec), "r"(name), "r"(argc), "r"(argv), "r"(argc) 
-      : "a0", "a1", "a2", "a3", "v0"
-    );
+    if (n > PROCINFO_MAX) {
+        n = PROCINFO_MAX;
+    }
+    struct procinfo *info;
+    if ((info = kmalloc(n * sizeof(struct procinfo))) == NULL) {
+        return -E_NO_MEM;
+    }
+
+    // take the snapshot first, copy_to_user may sleep and the processes change meanwhile
+    int i = 0, ret;
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        procinfo_fill(info + i ++, idleproc);
+        list_entry_t *le = &proc_list;
+        while (i < n && (le = list_next(le)) != &proc_list) {
+            procinfo_fill(info + i ++, le2proc(le, list_link));
+        }
+    }
+    local_intr_restore(intr_flag);
+
+    lock_mm(mm);
+    ret = copy_to_user(mm, buf, info, i * sizeof(struct procinfo)) ? i : -E_INVAL;
+    unlock_mm(mm);
+    kfree(info);
     return ret;
 }
 
-// 是下面user_main的真正实现，写成宏应该是为了可变参数
-#define __KERNEL_EXECVE(name, path, ...) ({                         \
-const char *argv[] = {path, ##__VA_ARGS__, NULL};       \
-					 kprintf("kernel_execve: pid = %d, name = \"%s\".\n",    \
-							 current->pid, name);                            \
-					 kernel_execve(name, argv);                              \
-})
+// sched_find_proc - the process pid, current if pid is 0; NULL if there is none
+static struct proc_struct *
+sched_find_proc(int pid) {
+    struct proc_struct *proc = (pid == 0) ? current : find_proc(pid);
+    if (proc == NULL || proc->state == PROC_ZOMBIE) {
+        return NULL;
+    }
+    return proc;
+}
 
-#define KERNEL_EXECVE(x, ...)                   __KERNEL_EXECVE(#x, #x, ##__VA_ARGS__)
+// do_schedstat - called by sys_schedstat: copy the scheduler statistics of pid (0 for
+//              - current) to stat in user space
+int
+do_schedstat(int pid, struct schedstat *stat) {
+    struct mm_struct *mm = current->mm;
+    struct proc_struct *proc;
+    struct schedstat kstat;
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    if ((proc = sched_find_proc(pid)) != NULL) {
+        schedstat_fill(&kstat, proc);
+    }
+    local_intr_restore(intr_flag);
+    if (proc == NULL) {
+        return -E_INVAL;
+    }
 
-#define KERNEL_EXECVE2(x, ...)                  KERNEL_EXECVE(x, ##__VA_ARGS__)
+    int ret = 0;
+    lock_mm(mm);
+    if (!copy_to_user(mm, stat, &kstat, sizeof(struct schedstat))) {
+        ret = -E_INVAL;
+    }
+    unlock_mm(mm);
+    return ret;
+}
 
-#define __KERNEL_EXECVE3(x, s, ...)             KERNEL_EXECVE(x, #s, ##__VA_ARGS__)
+// do_schedlat - called by sys_schedlat: copy the system wide scheduler latencies to lat
+//             - in user space, and clear them if flags has SCHEDLAT_RESET
+int
+do_schedlat(struct schedlat *lat, int flags) {
+    struct mm_struct *mm = current->mm;
+    struct schedlat klat;
+    schedlat_read(&klat, flags & SCHEDLAT_RESET);
 
-#define KERNEL_EXECVE3(x, s, ...)               __KERNEL_EXECVE3(x, s, ##__VA_ARGS__)
+    int ret = 0;
+    lock_mm(mm);
+    if (!copy_to_user(mm, lat, &klat, sizeof(struct schedlat))) {
+        ret = -E_INVAL;
+    }
+    unlock_mm(mm);
+    return ret;
+}
 
-// user_main - kernel thread used to exec a user program
-static int
-user_main(void *arg) {
-    KERNEL_EXECVE(sh);
-    panic("user_main execve failed.\n");
+// do_nice - set the nice value of pid (0 for current), its weight in fair_sched_class
+int
+do_nice(int pid, int nice) {
+    struct proc_struct *proc;
+    if (nice < NICE_MIN || nice > NICE_MAX) {
+        return -E_INVAL;
+    }
+    bool intr_flag;
+    int ret = -E_INVAL;
+    local_intr_save(intr_flag);
+    if ((proc = sched_find_proc(pid)) != NULL) {
+        proc->nice = nice;
+        ret = 0;
+    }
+    local_intr_restore(intr_flag);
+    return ret;
+}
+
+// do_sched_setscheduler - set the policy (SCHED_*) and the real time priority of pid (0
+//                       - for current); rt_priority must be 0 for SCHED_NORMAL
+int
+do_sched_setscheduler(int pid, int policy, int rt_priority) {
+    struct proc_struct *proc;
+    if (policy == SCHED_NORMAL) {
+        if (rt_priority != 0) {
+            return -E_INVAL;
+        }
+    }
+    else if (policy != SCHED_FIFO && policy != SCHED_RR) {
+        return -E_INVAL;
+    }
+    else if (rt_priority < RT_PRIO_MIN || rt_priority >= RT_PRIO_MAX) {
+        return -E_INVAL;
+    }
+    bool intr_flag;
+    int ret = -E_INVAL;
+    local_intr_save(intr_flag);
+    if ((proc = sched_find_proc(pid)) != NULL && proc != idleproc) {
+        sched_setscheduler(proc, policy, rt_priority);
+        ret = 0;
+    }
+    local_intr_restore(intr_flag);
+    return ret;
 }
 
 // 其实是检查你写的程序对不对的——通过新建进程，检查相关属性
-// init_main - the second kernel thread used to create user_main kernel threads
+// init_main - the second kernel thread used to spawn the user shell
 static int
 init_main(void *arg) {
 	int ret;
@@ -1019,16 +1529,20 @@ init_main(void *arg) {
     size_t nr_free_pages_store = nr_free_pages();
     size_t slab_allocated_store = kallocated();
 
-    int pid = kernel_thread(user_main, NULL, 0);
+    // sh is spawned with no files, umain opens the console for it
+    const char *argv[] = {"sh", NULL};
+    int pid = do_spawn(1, argv, -1, -1);
     if (pid <= 0) {
-        panic("create user_main failed.\n");
+        panic("spawn sh failed: %e.\n", pid);
     }
+    kprintf("spawn: pid = %d, name = \"%s\".\n", pid, argv[0]);
 
     while (do_wait(0, NULL) == 0) {
         schedule();
     }
 
     fs_cleanup();
+    proc_cache_shrink();
     kprintf("all user-mode processes have quit.\n");
     assert(initproc->cptr == NULL && initproc->yptr == NULL && initproc->optr == NULL);
     assert(nr_process == 2);
@@ -1040,6 +1554,28 @@ init_main(void *arg) {
     return 0;
 }
 
+// print_proc_overhead - print what a user process costs before it maps any user page,
+//                     - and the deepest kernel stack seen (see KSTACK_DEPTH_CHECK)
+void
+print_proc_overhead(void) {
+    size_t proc_size = kmalloc_size(sizeof(struct proc_struct));
+    size_t mm_size = kmalloc_size(sizeof(struct mm_struct));
+    size_t fs_size = kmalloc_size(sizeof(struct fs_struct))
+        + kmalloc_size(FILEMAP_CHUNK_NENTRY * sizeof(struct file));
+    kprintf("per-process memory (bytes):\n");
+    kprintf("  proc_struct %5d (%d used)\n", proc_size, sizeof(struct proc_struct));
+    kprintf("  kstack      %5d (%d pages)\n", KSTACKSIZE, KSTACKPAGE);
+    kprintf("  fs_struct   %5d (%d fds, up to %d)\n", fs_size, FILEMAP_CHUNK_NENTRY, FS_STRUCT_NENTRY);
+    kprintf("  mm_struct   %5d\n", mm_size);
+    kprintf("  pgdir       %5d\n", PGSIZE);
+    kprintf("  total       %5d\n", proc_size + KSTACKSIZE + fs_size + mm_size + PGSIZE);
+    kprintf("proc cache: %d of %d proc_structs with kernel stacks.\n", nr_proc_cache, PROC_CACHE_MAX);
+    if (KSTACK_DEPTH_CHECK) {
+        kprintf("deepest kernel stack: %d bytes of %d (%s).\n", kstack_max_depth, KSTACKSIZE,
+                (kstack_max_depth != 0) ? kstack_max_name : "no process exited yet");
+    }
+}
+
 // 初始化proc_list、hash_list。创建第一个内核线程idleproc，然后再创建其子进程initproc
 // proc_init - set up the first kernel thread idleproc "idle" by itself and 
 //           - create the second kernel thread init_main
@@ -1048,8 +1584,9 @@ proc_init(void) {
     int i;
 
     list_init(&proc_list);
-    for (i = 0; i < HASH_LIST_SIZE; i ++) {
-        list_init(hash_list + i);
+    list_init(&proc_cache);
+    for (i = 0; i < (1 << PID_HASH_MIN_SHIFT); i ++) {
+        list_init(hash_list_min + i);
     }
 
     if ((idleproc = alloc_proc()) == NULL) {
@@ -1086,13 +1623,46 @@ proc_init(void) {
 // 不停轮询看当前进程需不需要调度，需要就调用调度器（貌似只有idleproc会调用此函数？）
 // idleproc内核线程的工作就是不停地查询，看是否有其他内核线程可以执行了，如果有，马上让调度器选择那个内核线程执行——实验说明
 // 在 sched_class_proc_tick 会设置need_resched=1，有两种情况：是idleproc则直接置1，不是就等时间片没了置1
+// 没有进程需要调度时，利用空闲时间为预清零页池补充页面（zero_pool_refill 在 need_resched 置位时立即返回）
+// 之后再扫描一批用户页，合并内容相同的页（ksm_scan 每个 tick 最多扫描一批）
 // cpu_idle - at the end of kern_init, the first kernel thread idleproc will do below works
 void
 cpu_idle(void) {
+    bool intr_flag;
     while (1) {
         if (current->need_resched) {
             schedule();
         }
+        else {
+            // 预算用完留下的底半部
+            if (softirq_pending != 0) {
+                do_softirq();
+                continue ;
+            }
+            zero_pool_refill();
+            ksm_scan();
+            if (current->need_resched) {
+                continue ;
+            }
+            // 没事可做：停掉时钟直到下一个定时器到期，然后等中断
+            // (rechecked with interrupts off: work left by the softirq budgets, or raised
+            // or woken by zero_pool_refill / ksm_scan, must not wait with the tick stopped)
+            local_intr_save(intr_flag);
+            bool busy = (softirq_pending != 0 || current->need_resched);
+            if (!busy) {
+                clock_nohz_enter(sched_next_event());
+            }
+            local_intr_restore(intr_flag);
+            if (busy) {
+                continue ;
+            }
+
+            cpu_wait(&(current->need_resched));
+
+            local_intr_save(intr_flag);
+            clock_nohz_exit();
+            local_intr_restore(intr_flag);
+        }
     }
 }
 
@@ -1118,3 +1688,66 @@ do_sleep(unsigned int time) {
     del_timer(timer);
     return 0;
 }
+
+// do_nanosleep - sleep for the time in req, in user space, with the resolution of CP0 Count
+int
+do_nanosleep(const struct timespec *req) {
+    struct mm_struct *mm = current->mm;
+    struct timespec ts;
+    lock_mm(mm);
+    if (!copy_from_user(mm, &ts, req, sizeof(struct timespec), 0)) {
+        unlock_mm(mm);
+        return -E_INVAL;
+    }
+    unlock_mm(mm);
+    if (ts.tv_nsec >= NSEC_PER_SEC) {
+        return -E_INVAL;
+    }
+    uint64_t delta = timespec_to_count(&ts);
+    if (delta == 0) {
+        return 0;
+    }
+
+    bool intr_flag;
+    hrtimer_t __timer, *timer = &__timer;
+    local_intr_save(intr_flag);
+    hrtimer_init(timer, current, clock_read() + delta);
+    current->state = PROC_SLEEPING;
+    current->wait_state = WT_TIMER;
+    hrtimer_start(timer);
+    local_intr_restore(intr_flag);
+
+    schedule();
+
+    hrtimer_cancel(timer);
+    // cut short by do_kill
+    return (current->flags & PF_EXITING) ? -E_KILLED : 0;
+}
+
+// do_clock_gettime - store the time of clock (CLOCK_*) to ts in user space
+int
+do_clock_gettime(int clock, struct timespec *ts) {
+    struct mm_struct *mm = current->mm;
+    struct timespec kts;
+    if (clock != CLOCK_REALTIME && clock != CLOCK_MONOTONIC) {
+        return -E_INVAL;
+    }
+    clock_gettime_mono(&kts);
+    int ret = 0;
+    lock_mm(mm);
+    if (!copy_to_user(mm, ts, &kts, sizeof(struct timespec))) {
+        ret = -E_INVAL;
+    }
+    unlock_mm(mm);
+    return ret;
+}
+
+// do_set_priority - set the priority of current, 0 is the default and the highest; for
+//                 - mlfq_sched_class it is the top level the process can be lifted to.
+//                 - It takes effect when current is enqueued next, and children inherit it.
+int
+do_set_priority(uint32_t priority) {
+    current->lab6_priority = priority;
+    current->need_resched = 1;
+    return 0;
+}
@@ -5,6 +5,9 @@
 #include <list.h>
 #include <trap.h>
 #include <memlayout.h>
+#include <procinfo.h>
+#include <rb_tree.h>
+#include <time.h>
 
 // 枚举，进程状态，
 // 比x86版多了个PROC_FORCE_32——而且没有代码用到它，我觉得删了都行
@@ -43,6 +46,7 @@ struct context {
 #define PROC_NAME_LEN               30                  // 进程名长度
 #define MAX_PROCESS                 4096                // OS 中最大的进程数
 #define MAX_PID                     (MAX_PROCESS * 2)   // OS 中最大的进程号
+#define PROCINFO_MAX                256                 // the most processes in one do_procinfo
 
 extern list_entry_t proc_list;
 
@@ -68,18 +72,43 @@ struct proc_struct {
     struct run_queue *rq;                       // running queue contains Process
     list_entry_t run_link;                      // the entry linked in run queue
     int time_slice;                             // time slice for occupying the CPU
+    uint32_t lab6_priority;                     // priority set by lab6_set_priority, inherited by fork
+    int mlfq_level;                             // the level in mlfq_sched_class, 0 the highest
+    uint32_t mlfq_gen;                          // the rq->mlfq_gen of the last boost seen
+    int nice;                                   // NICE_MIN..NICE_MAX, the weight in fair_sched_class
+    int policy;                                 // SCHED_*, SCHED_FIFO and SCHED_RR are in rt_sched_class
+    int rt_priority;                            // RT_PRIO_MIN..RT_PRIO_MAX - 1, 0 for SCHED_NORMAL
+    rb_node fair_link;                          // the node in rq->fair_tree
+    uint32_t vruntime;                          // virtual runtime in fair_sched_class
+    uint32_t fair_charged;                      // the CPU ticks already added to vruntime
+    uint32_t nr_wakeups;                        // # of times woken up
+    struct cputime run_delay;                   // time spent runnable, waiting for the CPU
+    uint32_t max_delay;                         // the longest such wait, in CP0 Count cycles
+    uint32_t delay_stamp;                       // CP0 Count when it was last enqueued
+    bool woken;                                 // enqueued by wakeup_proc, not run since
+    bool slice_expired;                         // proc_tick asked to reschedule it
+    uint32_t max_wakeup;                        // the longest wait from wakeup_proc to running
+    uint32_t wakeup_hist[SCHEDLAT_NBUCKET];     // those waits, see schedlat_account
+    uint32_t nr_switch[SWITCH_NR];              // # of calls to schedule by why, SWITCH_*
     struct fs_struct *fs_struct;                // the file related info(pwd, files_count, files_array, fs_semaphore) of process
+    list_entry_t thread_group;                  // the other threads sharing the mm, see do_clone
+    struct cputime times[CPUTIME_NR];           // CPU time used, see cputime_switch
+    uint32_t nvcsw, nivcsw;                     // # of voluntary / involuntary context switches
+    int preempt_count;                          // preempt_count while switched out, see preempt.h
 };
 
 
 #define PF_EXITING                  0x00000001      // getting shutdown
 
+#define CLONE_SPAWN                 0x00010000      // kernel only, see do_spawn: no mm and no files are copied
+
 #define WT_CHILD                    (0x00000001 | WT_INTERRUPTED)
 #define WT_INTERRUPTED               0x80000000                    // the wait state could be interrupted
 #define WT_CHILD                    (0x00000001 | WT_INTERRUPTED)  // wait child process
 #define WT_KSEM                      0x00000100                    // wait kernel semaphore
 #define WT_TIMER                    (0x00000002 | WT_INTERRUPTED)  // wait timer
 #define WT_KBD                      (0x00000004 | WT_INTERRUPTED)  // wait the input of keyboard
+#define WT_FUTEX                    (0x00000008 | WT_INTERRUPTED)  // wait a futex word
 
 // 剩下就是proc.c里函数的声明了
 #define le2proc(le, member)         \
@@ -94,15 +123,29 @@ int kernel_thread(int (*fn)(void *), void *arg, uint32_t clone_flags);
 char *set_proc_name(struct proc_struct *proc, const char *name);
 char *get_proc_name(struct proc_struct *proc);
 void cpu_idle(void) __attribute__((noreturn));
+void cpu_wait(volatile bool *need_resched);
 
 struct proc_struct *find_proc(int pid);
 int do_fork(uint32_t clone_flags, uintptr_t stack, struct trapframe *tf);
 int do_exit(int error_code);
+int do_exit_group(int error_code);
+int do_clone(uint32_t clone_flags, uintptr_t stack, uintptr_t entry, uintptr_t arg);
 int do_yield(void);
 int do_execve(const char *name, int argc, const char **argv);
+int do_spawn(int argc, const char **argv, int fd_in, int fd_out);
+int do_procinfo(struct procinfo *buf, int n);
 int do_wait(int pid, int *code_store);
 int do_kill(int pid);
 int do_sleep(unsigned int time);
+int do_nanosleep(const struct timespec *req);
+int do_clock_gettime(int clock, struct timespec *ts);
+int do_set_priority(uint32_t priority);
+int do_nice(int pid, int nice);
+int do_sched_setscheduler(int pid, int policy, int rt_priority);
+int do_schedstat(int pid, struct schedstat *stat);
+int do_schedlat(struct schedlat *lat, int flags);
+void print_proc_overhead(void);
+size_t proc_cache_shrink(void);
 
 #endif /* !__KERN_PROCESS_PROC_H__ */
 
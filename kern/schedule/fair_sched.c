@@ -0,0 +1,167 @@
+// 公平调度：按虚拟运行时间（vruntime）把可运行进程排在红黑树里，总是运行 vruntime 最小的那个
+
+#include <defs.h>
+#include <rb_tree.h>
+#include <proc.h>
+#include <stdio.h>
+#include <assert.h>
+#include <fair_sched.h>
+
+/* Every tick of CPU time adds fair_vdelta[nice] to the vruntime of a process: 1024 at
+   nice 0, and about 1.25 times more (less) for each nice level up (down), the inverse of
+   the weights of Linux's CFS. So processes that always want the CPU get shares in
+   proportion to their weights. The ticks are those of proc->times (see cputime_switch),
+   so a process that never runs across a timer interrupt is charged as well; only whole
+   ticks are charged, the CPU has no multiply or divide.
+
+   - the runnable processes sit in rq->fair_tree keyed by vruntime, pick_next takes the
+     leftmost;
+   - the running process keeps the CPU for at least FAIR_MIN_GRANULARITY ticks, then it
+     is preempted once its vruntime is FAIR_SCHED_GRAN ahead of the leftmost;
+   - rq->fair_min_vruntime only grows; a new process starts there, and a process that
+     slept starts at most FAIR_SLEEPER_CREDIT before it, so it runs soon after waking but
+     cannot save up CPU time by sleeping;
+   - a woken process preempts current if it is FAIR_WAKEUP_GRAN behind it.
+
+   vruntime wraps around, always compare it with fair_before. */
+
+static const uint32_t fair_vdelta[NICE_MAX - NICE_MIN + 1] = {
+    /* -20 */     12,     15,     19,     23,     29,
+    /* -15 */     36,     45,     56,     70,     88,
+    /* -10 */    110,    138,    172,    214,    268,
+    /*  -5 */    336,    419,    527,    661,    821,
+    /*   0 */   1024,   1279,   1601,   1993,   2479,
+    /*   5 */   3130,   3855,   4877,   6096,   7654,
+    /*  10 */   9533,  12053,  14980,  18725,  23302,
+    /*  15 */  29127,  36158,  45590,  58254,  69905,
+};
+
+#define fair_before(a, b)               ((int32_t)((a) - (b)) < 0)
+#define le2fair(node)                   to_struct((node), struct proc_struct, fair_link)
+
+static int
+fair_compare(rb_node *node1, rb_node *node2) {
+    uint32_t v1 = le2fair(node1)->vruntime, v2 = le2fair(node2)->vruntime;
+    if (v1 == v2) {
+        return 0;
+    }
+    return fair_before(v1, v2) ? -1 : 1;
+}
+
+// fair_leftmost - the runnable process with the smallest vruntime, NULL if none
+static struct proc_struct *
+fair_leftmost(struct run_queue *rq) {
+    rb_node *node = rb_node_root(rq->fair_tree), *left;
+    if (node == NULL) {
+        return NULL;
+    }
+    while ((left = rb_node_left(rq->fair_tree, node)) != NULL) {
+        node = left;
+    }
+    return le2fair(node);
+}
+
+// fair_update_min - move fair_min_vruntime up to the smallest vruntime of running (NULL
+//                 - if it is not a fair process) and the queued processes
+static void
+fair_update_min(struct run_queue *rq, struct proc_struct *running) {
+    struct proc_struct *left = fair_leftmost(rq);
+    uint32_t vmin;
+    if (running != NULL) {
+        vmin = running->vruntime;
+        if (left != NULL && fair_before(left->vruntime, vmin)) {
+            vmin = left->vruntime;
+        }
+    }
+    else if (left != NULL) {
+        vmin = left->vruntime;
+    }
+    else {
+        return ;
+    }
+    if (fair_before(rq->fair_min_vruntime, vmin)) {
+        rq->fair_min_vruntime = vmin;
+    }
+}
+
+// fair_charge - add the CPU time proc used since the last charge to its vruntime
+static void
+fair_charge(struct proc_struct *proc) {
+    uint32_t busy = proc->times[CPUTIME_USER].ticks + proc->times[CPUTIME_SYS].ticks
+        + proc->times[CPUTIME_IRQ].ticks;
+    uint32_t vdelta = fair_vdelta[proc->nice - NICE_MIN];
+    while (proc->fair_charged != busy) {
+        proc->fair_charged ++;
+        proc->vruntime += vdelta;
+    }
+}
+
+static void
+fair_init(struct run_queue *rq) {
+    if ((rq->fair_tree = rb_tree_create(fair_compare)) == NULL) {
+        panic("fair_init: no memory for the run queue.\n");
+    }
+    rq->fair_min_vruntime = 0;
+    rq->proc_num = 0;
+}
+
+static void
+fair_enqueue(struct run_queue *rq, struct proc_struct *proc) {
+    fair_charge(proc);
+    if (proc != current) {
+        // 新建的或刚被唤醒的进程：放在 min_vruntime 附近，而不是它自己原来的位置
+        bool fair_current = (current != idleproc && current->policy == SCHED_NORMAL);
+        fair_update_min(rq, fair_current ? current : NULL);
+        uint32_t vstart = rq->fair_min_vruntime;
+        if (proc->runs != 0) {
+            vstart -= FAIR_SLEEPER_CREDIT;
+        }
+        if (proc->runs == 0 || fair_before(proc->vruntime, vstart)) {
+            proc->vruntime = vstart;
+        }
+        if (fair_current && (int32_t)(current->vruntime - proc->vruntime) > FAIR_WAKEUP_GRAN) {
+            current->need_resched = 1;
+        }
+    }
+    rb_insert(rq->fair_tree, &(proc->fair_link));
+    proc->time_slice = FAIR_MIN_GRANULARITY;
+    proc->rq = rq;
+    rq->proc_num ++;
+}
+
+static void
+fair_dequeue(struct run_queue *rq, struct proc_struct *proc) {
+    assert(proc->rq == rq && rq->proc_num > 0);
+    rb_delete(rq->fair_tree, &(proc->fair_link));
+    rq->proc_num --;
+}
+
+static struct proc_struct *
+fair_pick_next(struct run_queue *rq) {
+    return fair_leftmost(rq);
+}
+
+static void
+fair_proc_tick(struct run_queue *rq, struct proc_struct *proc) {
+    fair_charge(proc);
+    fair_update_min(rq, proc);
+    if (proc->time_slice > 0) {
+        proc->time_slice --;
+    }
+    if (proc->time_slice == 0) {
+        struct proc_struct *left = fair_leftmost(rq);
+        if (left != NULL && (int32_t)(proc->vruntime - left->vruntime) >= FAIR_SCHED_GRAN) {
+            proc->need_resched = 1;
+        }
+    }
+}
+
+struct sched_class fair_sched_class = {
+    .name = "fair_scheduler",
+    .init = fair_init,
+    .enqueue = fair_enqueue,
+    .dequeue = fair_dequeue,
+    .pick_next = fair_pick_next,
+    .proc_tick = fair_proc_tick,
+};
+
@@ -0,0 +1,9 @@
+#ifndef __KERN_SCHEDULE_SCHED_FAIR_H__
+#define __KERN_SCHEDULE_SCHED_FAIR_H__
+
+#include <sched.h>
+
+extern struct sched_class fair_sched_class;
+
+#endif /* !__KERN_SCHEDULE_SCHED_FAIR_H__ */
+
@@ -0,0 +1,103 @@
+// 高精度定时器：按 64 位的 CP0 Count 到期时间排在红黑树里，由时钟中断在到期时唤醒进程
+
+#include <defs.h>
+#include <rb_tree.h>
+#include <sync.h>
+#include <proc.h>
+#include <sched.h>
+#include <clock.h>
+#include <stdio.h>
+#include <assert.h>
+#include <hrtimer.h>
+
+/* The timing wheel of sched.c works in whole ticks. An hrtimer is due at a CP0 Count
+   cycle instead: the pending ones are kept in hrtimer_tree by expiry, and clock.c sets
+   Compare to the earliest of them when it comes before the next tick, so the timer
+   interrupt arrives when the first hrtimer is due, not at the tick after it. */
+
+static rb_tree *hrtimer_tree;
+
+#define rbn2hrtimer(node)               to_struct((node), hrtimer_t, rb_link)
+
+static int
+hrtimer_compare(rb_node *node1, rb_node *node2) {
+    uint64_t e1 = rbn2hrtimer(node1)->expires, e2 = rbn2hrtimer(node2)->expires;
+    return (e1 < e2) ? -1 : ((e1 > e2) ? 1 : 0);
+}
+
+// hrtimer_first - the pending hrtimer due first, NULL if none; also before
+//               - hrtimer_subsys_init, as clock_init already asks
+static hrtimer_t *
+hrtimer_first(void) {
+    rb_node *node, *left;
+    if (hrtimer_tree == NULL || (node = rb_node_root(hrtimer_tree)) == NULL) {
+        return NULL;
+    }
+    while ((left = rb_node_left(hrtimer_tree, node)) != NULL) {
+        node = left;
+    }
+    return rbn2hrtimer(node);
+}
+
+void
+hrtimer_subsys_init(void) {
+    if ((hrtimer_tree = rb_tree_create(hrtimer_compare)) == NULL) {
+        panic("hrtimer_subsys_init: no memory.\n");
+    }
+}
+
+// hrtimer_start - queue timer, and move the next timer interrupt earlier if needed
+void
+hrtimer_start(hrtimer_t *timer) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        assert(!timer->queued && timer->proc != NULL);
+        rb_insert(hrtimer_tree, &(timer->rb_link));
+        timer->queued = 1;
+        clock_reprogram();
+    }
+    local_intr_restore(intr_flag);
+}
+
+// hrtimer_cancel - dequeue timer if it has not expired; an interrupt set up for it is
+//                - left alone, it only finds nothing to do
+void
+hrtimer_cancel(hrtimer_t *timer) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        if (timer->queued) {
+            rb_delete(hrtimer_tree, &(timer->rb_link));
+            timer->queued = 0;
+        }
+    }
+    local_intr_restore(intr_flag);
+}
+
+// hrtimer_next - store the expiry of the first pending hrtimer, return 0 if there is none
+bool
+hrtimer_next(uint64_t *expires) {
+    hrtimer_t *timer;
+    if ((timer = hrtimer_first()) == NULL) {
+        return 0;
+    }
+    *expires = timer->expires;
+    return 1;
+}
+
+// hrtimer_run - called by the timer interrupt: wake up the processes of the hrtimers due by now
+void
+hrtimer_run(uint64_t now) {
+    hrtimer_t *timer;
+    while ((timer = hrtimer_first()) != NULL && timer->expires <= now) {
+        struct proc_struct *proc = timer->proc;
+        rb_delete(hrtimer_tree, &(timer->rb_link));
+        timer->queued = 0;
+        if (proc->wait_state != 0) {
+            assert(proc->wait_state & WT_INTERRUPTED);
+            wakeup_proc(proc);
+        }
+    }
+}
+
@@ -0,0 +1,32 @@
+#ifndef __KERN_SCHEDULE_HRTIMER_H__
+#define __KERN_SCHEDULE_HRTIMER_H__
+
+#include <defs.h>
+#include <rb_tree.h>
+
+struct proc_struct;
+
+// a high resolution timer: wakes proc up when the monotonic clock (clock_read) reaches expires
+typedef struct {
+    uint64_t expires;                   // in CP0 Count cycles since boot
+    struct proc_struct *proc;
+    rb_node rb_link;
+    bool queued;
+} hrtimer_t;
+
+static inline hrtimer_t *
+hrtimer_init(hrtimer_t *timer, struct proc_struct *proc, uint64_t expires) {
+    timer->expires = expires;
+    timer->proc = proc;
+    timer->queued = 0;
+    return timer;
+}
+
+void hrtimer_subsys_init(void);
+void hrtimer_start(hrtimer_t *timer);
+void hrtimer_cancel(hrtimer_t *timer);
+bool hrtimer_next(uint64_t *expires);
+void hrtimer_run(uint64_t now);
+
+#endif /* !__KERN_SCHEDULE_HRTIMER_H__ */
+
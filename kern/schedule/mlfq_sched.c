@@ -0,0 +1,147 @@
+// 多级反馈队列（MLFQ）调度：用完时间片就降级，因等待而阻塞就升级，并定期把所有进程提回顶层
+
+#include <defs.h>
+#include <list.h>
+#include <proc.h>
+#include <assert.h>
+#include <mlfq_sched.h>
+
+/* Level 0 is the highest. A process runs MLFQ_SLICE(level) ticks at a time, so the
+   lower levels, where the CPU-bound processes sink to, get longer but rarer slices.
+
+   - a process that uses up its slice moves one level down;
+   - a process that blocks in do_sleep, dev_stdin_read or a semaphore (see proc_block
+     in schedule) moves one level up, so the shell and the readers of a pipeline come
+     back at the top and preempt a batch job as soon as they are woken;
+   - every MLFQ_BOOST_INTERVAL ticks all processes go back to their top level, so the
+     batch jobs at the bottom do not starve behind a crowd of interactive ones.
+
+   The top level of a process is its priority (lab6_set_priority), 0 by default: a
+   process with priority p never rises above level p. Processes that are asleep during
+   a boost are lifted when they are enqueued again, mlfq_gen tells them apart. */
+
+#define MLFQ_SLICE(level)               (MLFQ_SLICE_MIN << (level))
+
+static inline int
+mlfq_top(struct proc_struct *proc) {
+    return (proc->lab6_priority < MLFQ_NLEVEL) ? proc->lab6_priority : MLFQ_NLEVEL - 1;
+}
+
+static void
+MLFQ_init(struct run_queue *rq) {
+    int level;
+    for (level = 0; level < MLFQ_NLEVEL; level ++) {
+        list_init(&(rq->mlfq_list[level]));
+    }
+    rq->mlfq_boost = MLFQ_BOOST_INTERVAL;
+    rq->mlfq_gen = 0;
+    rq->proc_num = 0;
+}
+
+static void
+MLFQ_enqueue(struct run_queue *rq, struct proc_struct *proc) {
+    assert(list_empty(&(proc->run_link)));
+    int top = mlfq_top(proc);
+    if (proc->mlfq_gen != rq->mlfq_gen) {
+        proc->mlfq_gen = rq->mlfq_gen;
+        proc->mlfq_level = top, proc->time_slice = 0;
+    }
+    else if (proc->mlfq_level < top) {
+        proc->mlfq_level = top, proc->time_slice = 0;
+    }
+    if (proc->time_slice == 0 || proc->time_slice > MLFQ_SLICE(proc->mlfq_level)) {
+        proc->time_slice = MLFQ_SLICE(proc->mlfq_level);
+    }
+    list_add_before(&(rq->mlfq_list[proc->mlfq_level]), &(proc->run_link));
+    proc->rq = rq;
+    rq->proc_num ++;
+    // 被唤醒的进程级别更高，就不必等当前进程用完它（可能很长的）时间片
+    if (proc != current && current->policy == SCHED_NORMAL && proc->mlfq_level < current->mlfq_level) {
+        current->need_resched = 1;
+    }
+}
+
+static void
+MLFQ_dequeue(struct run_queue *rq, struct proc_struct *proc) {
+    assert(!list_empty(&(proc->run_link)) && proc->rq == rq);
+    list_del_init(&(proc->run_link));
+    rq->proc_num --;
+}
+
+// 取最高的非空级别的第一个进程
+static struct proc_struct *
+MLFQ_pick_next(struct run_queue *rq) {
+    int level;
+    for (level = 0; level < MLFQ_NLEVEL; level ++) {
+        list_entry_t *le = list_next(&(rq->mlfq_list[level]));
+        if (le != &(rq->mlfq_list[level])) {
+            return le2proc(le, run_link);
+        }
+    }
+    return NULL;
+}
+
+// mlfq_boost - move every process back to its top level, keeping their order
+static void
+mlfq_boost(struct run_queue *rq, struct proc_struct *running) {
+    int level;
+    rq->mlfq_gen ++;
+    for (level = 1; level < MLFQ_NLEVEL; level ++) {
+        list_entry_t *list = &(rq->mlfq_list[level]), *le = list_next(list);
+        while (le != list) {
+            struct proc_struct *proc = le2proc(le, run_link);
+            le = list_next(le);
+            proc->mlfq_gen = rq->mlfq_gen;
+            if (proc->mlfq_level != mlfq_top(proc)) {
+                proc->mlfq_level = mlfq_top(proc);
+                proc->time_slice = MLFQ_SLICE(proc->mlfq_level);
+                list_del(&(proc->run_link));
+                list_add_before(&(rq->mlfq_list[proc->mlfq_level]), &(proc->run_link));
+            }
+        }
+    }
+    running->mlfq_gen = rq->mlfq_gen;
+    if (running->mlfq_level != mlfq_top(running)) {
+        running->mlfq_level = mlfq_top(running);
+        if (running->time_slice > MLFQ_SLICE(running->mlfq_level)) {
+            running->time_slice = MLFQ_SLICE(running->mlfq_level);
+        }
+    }
+}
+
+static void
+MLFQ_proc_tick(struct run_queue *rq, struct proc_struct *proc) {
+    if (-- rq->mlfq_boost == 0) {
+        rq->mlfq_boost = MLFQ_BOOST_INTERVAL;
+        mlfq_boost(rq, proc);
+    }
+    if (proc->time_slice > 0) {
+        proc->time_slice --;
+    }
+    if (proc->time_slice == 0) {
+        if (proc->mlfq_level < MLFQ_NLEVEL - 1) {
+            proc->mlfq_level ++;
+        }
+        proc->need_resched = 1;
+    }
+}
+
+// 进程因为等待 timer、键盘或信号量而阻塞：升一级，醒来时重新领取时间片
+static void
+MLFQ_proc_block(struct run_queue *rq, struct proc_struct *proc) {
+    if (proc->mlfq_level > mlfq_top(proc)) {
+        proc->mlfq_level --;
+    }
+    proc->time_slice = 0;
+}
+
+struct sched_class mlfq_sched_class = {
+    .name = "MLFQ_scheduler",
+    .init = MLFQ_init,
+    .enqueue = MLFQ_enqueue,
+    .dequeue = MLFQ_dequeue,
+    .pick_next = MLFQ_pick_next,
+    .proc_tick = MLFQ_proc_tick,
+    .proc_block = MLFQ_proc_block,
+};
+
@@ -0,0 +1,130 @@
+// 实时调度：SCHED_FIFO / SCHED_RR，固定优先级，总是先于普通进程运行
+
+#include <defs.h>
+#include <list.h>
+#include <proc.h>
+#include <assert.h>
+#include <rt_sched.h>
+
+/* One list per priority, RT_PRIO_MIN..RT_PRIO_MAX - 1, the larger the more urgent, and
+   a bitmap of the non-empty lists, so enqueue, dequeue and pick_next take constant time
+   however many processes are runnable. A SCHED_FIFO process runs until it blocks, yields
+   or a more urgent one wakes up; a SCHED_RR process also goes to the back of its list
+   every RT_RR_SLICE ticks.
+
+   schedule (sched.c) asks this class first. To keep a runaway RT process from hanging
+   the system the class may only use RT_RUNTIME ticks out of every RT_PERIOD: then it is
+   throttled, and runs only when no normal process is runnable, until the period ends. */
+
+// rt_highest - the highest bit set in map, which must not be 0
+static inline int
+rt_highest(uint32_t map) {
+    int bit = 0;
+    if (map >> 16) {
+        bit += 16, map >>= 16;
+    }
+    if (map >> 8) {
+        bit += 8, map >>= 8;
+    }
+    if (map >> 4) {
+        bit += 4, map >>= 4;
+    }
+    if (map >> 2) {
+        bit += 2, map >>= 2;
+    }
+    if (map >> 1) {
+        bit += 1;
+    }
+    return bit;
+}
+
+static void
+rt_init(struct run_queue *rq) {
+    static_assert(RT_PRIO_MAX <= 32);
+    int prio;
+    for (prio = 0; prio < RT_PRIO_MAX; prio ++) {
+        list_init(&(rq->rt_list[prio]));
+    }
+    rq->rt_bitmap = 0;
+    rq->rt_time = 0;
+    rq->rt_period_left = RT_PERIOD;
+    rq->rt_throttled = 0;
+}
+
+static void
+rt_enqueue(struct run_queue *rq, struct proc_struct *proc) {
+    assert(list_empty(&(proc->run_link)));
+    int prio = proc->rt_priority;
+    list_add_before(&(rq->rt_list[prio]), &(proc->run_link));
+    rq->rt_bitmap |= (1 << prio);
+    if (proc->time_slice == 0 || proc->time_slice > RT_RR_SLICE) {
+        proc->time_slice = RT_RR_SLICE;
+    }
+    proc->rq = rq;
+    rq->proc_num ++;
+    // 不等当前进程的时间片用完：从中断返回时就切换过来
+    if (proc != current && !rq->rt_throttled
+            && (current->policy == SCHED_NORMAL || current->rt_priority < prio)) {
+        current->need_resched = 1;
+    }
+}
+
+static void
+rt_dequeue(struct run_queue *rq, struct proc_struct *proc) {
+    assert(!list_empty(&(proc->run_link)) && proc->rq == rq);
+    int prio = proc->rt_priority;
+    list_del_init(&(proc->run_link));
+    if (list_empty(&(rq->rt_list[prio]))) {
+        rq->rt_bitmap &= ~(1 << prio);
+    }
+    rq->proc_num --;
+}
+
+static struct proc_struct *
+rt_pick_next(struct run_queue *rq) {
+    if (rq->rt_bitmap == 0) {
+        return NULL;
+    }
+    return le2proc(list_next(&(rq->rt_list[rt_highest(rq->rt_bitmap)])), run_link);
+}
+
+static void
+rt_proc_tick(struct run_queue *rq, struct proc_struct *proc) {
+    if (++ rq->rt_time >= RT_RUNTIME && !rq->rt_throttled) {
+        rq->rt_throttled = 1;
+        proc->need_resched = 1;
+    }
+    if (proc->policy == SCHED_RR) {
+        if (proc->time_slice > 0) {
+            proc->time_slice --;
+        }
+        if (proc->time_slice == 0) {
+            proc->need_resched = 1;
+        }
+    }
+}
+
+// rt_period_tick - called every tick: start a new throttling period when this one ends
+void
+rt_period_tick(struct run_queue *rq) {
+    if (-- rq->rt_period_left == 0) {
+        rq->rt_period_left = RT_PERIOD;
+        rq->rt_time = 0;
+        if (rq->rt_throttled) {
+            rq->rt_throttled = 0;
+            if (rq->rt_bitmap != 0) {
+                current->need_resched = 1;
+            }
+        }
+    }
+}
+
+struct sched_class rt_sched_class = {
+    .name = "RT_scheduler",
+    .init = rt_init,
+    .enqueue = rt_enqueue,
+    .dequeue = rt_dequeue,
+    .pick_next = rt_pick_next,
+    .proc_tick = rt_proc_tick,
+};
+
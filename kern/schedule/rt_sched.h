@@ -0,0 +1,11 @@
+#ifndef __KERN_SCHEDULE_SCHED_RT_H__
+#define __KERN_SCHEDULE_SCHED_RT_H__
+
+#include <sched.h>
+
+extern struct sched_class rt_sched_class;
+
+void rt_period_tick(struct run_queue *rq);
+
+#endif /* !__KERN_SCHEDULE_SCHED_RT_H__ */
+
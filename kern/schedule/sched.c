@@ -6,43 +6,93 @@
 #include <sched.h>
 #include <stdio.h>
 #include <assert.h>
+#include <string.h>
 #include <default_sched.h>
+#include <mlfq_sched.h>
+#include <fair_sched.h>
+#include <rt_sched.h>
+#include <hrtimer.h>
+#include <softirq.h>
+#include <clock.h>
+#include <asm/mipsregs.h>
 
  
 // 增加了定时器（timer）机制，用于进程/线程的do_sleep功能——实验手册
  
-// 计时器链表
+/* The timers are kept in a hierarchical timing wheel, as in the classic Linux one. A timer
+   due in less than TVR_SIZE ticks hangs in tv1, one slot per tick; later ones hang in
+   tv2..tv5, each slot of tvN covering TVR_SIZE * TVN_SIZE^(N-2) ticks. When tv1 wraps
+   around, the next slot of tv2 is cascaded down into tv1, and so on up. So add_timer and
+   del_timer take constant time, and each tick only looks at one slot of tv1, plus one
+   slot of each level it cascades; a timer is cascaded at most four times in its life.
+
+   timer_jiffies is the next tick to run, at most ticks + 1. timer->expires is relative
+   in timer_init and becomes the absolute tick it is due at in add_timer. */
  
-static list_entry_t timer_list;
+#define TVN_BITS                        6
+#define TVR_BITS                        8
+#define TVN_SIZE                        (1 << TVN_BITS)
+#define TVR_SIZE                        (1 << TVR_BITS)
+#define TVN_MASK                        (TVN_SIZE - 1)
+#define TVR_MASK                        (TVR_SIZE - 1)
+#define TIMER_MAX_EXPIRES               0x7FFFFFFF  // longer timeouts are cut to this many ticks
+
+static list_entry_t tv1[TVR_SIZE];
+static list_entry_t tvn[4][TVN_SIZE];   // tv2..tv5
+static size_t timer_jiffies;
 
-// 总调度器指针，指向了 default_sched.c 中的 default_sched_class
+// 普通（分时）进程的调度器，指向了 fair_sched.c 中的 fair_sched_class（换成 mlfq_sched_class 或 default_sched_class 也行）
+// SCHED_FIFO / SCHED_RR 的进程归 rt_sched_class 管，schedule 先问它
 static struct sched_class *sched_class;
 
 // 运行进程队列
 static struct run_queue *rq;
 
  
-// ↓这三个函数都只是包装一下sched_class->，可能是因为箭头不好打吧
+// ↓这几个函数都只是包装一下sched_class->，按进程的 policy 选出它所属的调度器
+
+// 进程所属的调度器
+static inline struct sched_class *
+proc_sched_class(struct proc_struct *proc) {
+    return (proc->policy == SCHED_NORMAL) ? sched_class : &rt_sched_class;
+}
  
 // 进程进入调度器
  
 static inline void
 sched_class_enqueue(struct proc_struct *proc) {
     if (proc != idleproc) {
-        sched_class->enqueue(rq, proc);
+        proc->delay_stamp = read_c0_count();
+        proc_sched_class(proc)->enqueue(rq, proc);
+        // a throttled real time process only gets the CPU no normal process wants
+        if (proc->policy == SCHED_NORMAL && rq->rt_throttled && proc != current
+                && current->policy != SCHED_NORMAL) {
+            current->need_resched = 1;
+        }
     }
 }
 
 // 进程离开调度器
 static inline void
 sched_class_dequeue(struct proc_struct *proc) {
-    sched_class->dequeue(rq, proc);
+    proc_sched_class(proc)->dequeue(rq, proc);
 }
 
-// 取调度器中的下一个进程
+// 取调度器中的下一个进程：实时进程优先；实时进程被限流时让普通进程先跑，
+// 但没有普通进程可跑时也不让 CPU 空着
 static inline struct proc_struct *
 sched_class_pick_next(void) {
-    return sched_class->pick_next(rq);
+    struct proc_struct *next = NULL;
+    if (!rq->rt_throttled) {
+        next = rt_sched_class.pick_next(rq);
+    }
+    if (next == NULL) {
+        next = sched_class->pick_next(rq);
+    }
+    if (next == NULL) {
+        next = rt_sched_class.pick_next(rq);
+    }
+    return next;
 }
 
 // 每一个 tick 调用`sched_class_proc_tick`，
@@ -53,9 +103,15 @@ sched_class_pick_next(void) {
 // 调度器中的进程时钟值+1
 static void
 sched_class_proc_tick(struct proc_struct *proc) {
+    bool resched = proc->need_resched;
+    rt_period_tick(rq);
     // 不为空闲进程则 tick 一次
     if (proc != idleproc) {
-        sched_class->proc_tick(rq, proc);
+        proc_sched_class(proc)->proc_tick(rq, proc);
+        // the tick, not a wakeup, took the CPU away: the slice ran out (or rt was throttled)
+        if (!resched && proc->need_resched) {
+            proc->slice_expired = 1;
+        }
     }
     // 为空闲进程则标记 need reschedule
     else {
@@ -63,8 +119,171 @@ sched_class_proc_tick(struct proc_struct *proc) {
     }
 }
 
+// 进程因为这些等待而阻塞时通知调度器（MLFQ 借此把交互式进程升级）：
+// do_sleep、dev_stdin_read 与信号量；用户态的 mutex 等在 futex 上，也算信号量
+static inline void
+sched_class_proc_block(struct proc_struct *proc) {
+    uint32_t ws = proc->wait_state;
+    if (proc->policy == SCHED_NORMAL && sched_class->proc_block != NULL
+            && (ws == WT_TIMER || ws == WT_KBD || ws == WT_KSEM || ws == WT_FUTEX)) {
+        sched_class->proc_block(rq, proc);
+    }
+}
+
 static struct run_queue __rq;
 
+/* CPU time accounting. cputime_mode is what the CPU is doing now (CPUTIME_*), and
+   cputime_stamp the CP0 Count when that started. Every change of mode, at trap entry
+   and exit in mips_trap and at each context switch in proc_run, charges the cycles
+   since cputime_stamp to current. */
+static uint32_t cputime_stamp;
+static int cputime_mode = CPUTIME_SYS;
+
+static inline void
+cputime_add(struct cputime *t, uint32_t delta) {
+    t->count += delta;
+    while (t->count >= TIMER0_INTERVAL) {
+        t->count -= TIMER0_INTERVAL;
+        t->ticks ++;
+    }
+}
+
+// cputime_switch - charge the time since the last switch to current, then enter mode;
+//                - return the mode left. Called with interrupts disabled.
+int
+cputime_switch(int mode) {
+    uint32_t now = read_c0_count();
+    int omode = cputime_mode;
+    if (current != NULL) {
+        cputime_add(current->times + omode, now - cputime_stamp);
+    }
+    cputime_stamp = now, cputime_mode = mode;
+    return omode;
+}
+
+/* Scheduler latency. A process is stamped (delay_stamp) whenever it is enqueued, and
+   schedlat_account sees the wait when schedule takes it off the run queue to run it.
+   Every wait goes to wait_hist; one that started in wakeup_proc (woken) is also a
+   wakeup latency, which goes to the process' own histogram and the system wide one.
+   The buckets are powers of two of CP0 Count cycles, see SCHEDLAT_NBUCKET.
+
+   The run queue length is sampled once a tick by run_timer_list. The ticks that
+   cpu_idle stopped are counted as empty ones: the tick is only stopped with nothing
+   runnable. All of it is changed with interrupts off. */
+static struct schedlat schedlat;
+static size_t rqlen_jiffies;            // the last tick sampled
+
+// schedlat_bucket - the histogram bucket of a wait of cycles
+static inline int
+schedlat_bucket(uint32_t cycles) {
+    int i = 0;
+    while (i < SCHEDLAT_NBUCKET - 1 && (cycles >> (i + SCHEDLAT_MIN_SHIFT)) != 0) {
+        i ++;
+    }
+    return i;
+}
+
+// schedlat_account - proc was just taken off the run queue to run, count its wait
+static void
+schedlat_account(struct proc_struct *proc) {
+    uint32_t delay = read_c0_count() - proc->delay_stamp;
+    cputime_add(&(proc->run_delay), delay);
+    if (delay > proc->max_delay) {
+        proc->max_delay = delay;
+    }
+    int i = schedlat_bucket(delay);
+    schedlat.wait_hist[i] ++;
+    if (proc->woken) {
+        proc->woken = 0;
+        proc->wakeup_hist[i] ++;
+        schedlat.wakeup_hist[i] ++;
+        if (delay > proc->max_wakeup) {
+            proc->max_wakeup = delay;
+        }
+        if (delay > schedlat.max_wakeup) {
+            schedlat.max_wakeup = delay;
+            schedlat.max_wakeup_pid = proc->pid;
+        }
+    }
+}
+
+// rqlen_sample - count the processes runnable in this tick, once a tick
+static void
+rqlen_sample(void) {
+    if (ticks == rqlen_jiffies) {
+        return ;
+    }
+    schedlat.rqlen_hist[0] += ticks - rqlen_jiffies - 1;
+    rqlen_jiffies = ticks;
+    uint32_t n = rq->proc_num + (current != idleproc);
+    schedlat.rqlen_hist[(n < RQLEN_NBUCKET) ? n : RQLEN_NBUCKET - 1] ++;
+    if (n > schedlat.max_rqlen) {
+        schedlat.max_rqlen = n;
+    }
+}
+
+// schedlat_read - copy the system wide latencies to lat, then start over if reset
+void
+schedlat_read(struct schedlat *lat, bool reset) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        *lat = schedlat;
+        if (reset) {
+            memset(&schedlat, 0, sizeof(schedlat));
+            rqlen_jiffies = ticks;
+        }
+    }
+    local_intr_restore(intr_flag);
+}
+
+ 
+// schedstat_fill - the scheduler statistics of proc, called with interrupts disabled
+void
+schedstat_fill(struct schedstat *stat, struct proc_struct *proc) {
+    stat->pid = proc->pid;
+    stat->nice = proc->nice;
+    stat->policy = proc->policy;
+    stat->rt_priority = proc->rt_priority;
+    stat->vruntime = proc->vruntime;
+    stat->nr_wakeups = proc->nr_wakeups;
+    stat->run_delay = proc->run_delay;
+    stat->max_delay = proc->max_delay;
+    stat->min_vruntime = rq->fair_min_vruntime;
+    stat->max_wakeup = proc->max_wakeup;
+    memcpy(stat->wakeup_hist, proc->wakeup_hist, sizeof(stat->wakeup_hist));
+    memcpy(stat->nr_switch, proc->nr_switch, sizeof(stat->nr_switch));
+}
+
+/* *
+ * sched_setscheduler - move proc to policy at rt_priority, both checked by the caller.
+ * A queued proc moves to the queue of its new class; current is moved by the schedule
+ * that follows. The CPU time proc used as a real time process is not charged to its
+ * vruntime when it comes back to the fair class.
+ * */
+void
+sched_setscheduler(struct proc_struct *proc, int policy, int rt_priority) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        bool queued = (proc->state == PROC_RUNNABLE && proc != current && proc != idleproc);
+        if (queued) {
+            sched_class_dequeue(proc);
+        }
+        if (proc->policy != SCHED_NORMAL && policy == SCHED_NORMAL) {
+            proc->fair_charged = proc->times[CPUTIME_USER].ticks + proc->times[CPUTIME_SYS].ticks
+                + proc->times[CPUTIME_IRQ].ticks;
+        }
+        proc->policy = policy, proc->rt_priority = rt_priority;
+        proc->time_slice = 0;
+        if (queued) {
+            sched_class_enqueue(proc);
+        }
+        current->need_resched = 1;
+    }
+    local_intr_restore(intr_flag);
+}
+
  
 // 初始化，初始化timer列表、sched_class（管理器）、runqueue
  
@@ -73,15 +292,29 @@ static struct run_queue __rq;
  
 void
 sched_init(void) {
-    list_init(&timer_list);
+    int i, n;
+    for (i = 0; i < TVR_SIZE; i ++) {
+        list_init(tv1 + i);
+    }
+    for (n = 0; n < 4; n ++) {
+        for (i = 0; i < TVN_SIZE; i ++) {
+            list_init(tvn[n] + i);
+        }
+    }
+    timer_jiffies = ticks;
+    open_softirq(TIMER_SOFTIRQ, run_timer_list);
+    hrtimer_subsys_init();
 
-    sched_class = &default_sched_class;
+    sched_class = &fair_sched_class;
 
     rq = &__rq;
     rq->max_time_slice = 20;
     sched_class->init(rq);
+    rt_sched_class.init(rq);
+    cputime_stamp = read_c0_count();
+    rqlen_jiffies = ticks;
 
-    kprintf("sched class: %s\n", sched_class->name);
+    kprintf("sched class: %s, %s\n", rt_sched_class.name, sched_class->name);
 }
 
  
@@ -100,8 +333,15 @@ wakeup_proc(struct proc_struct *proc) {
         if (proc->state != PROC_RUNNABLE) {
             proc->state = PROC_RUNNABLE;
             proc->wait_state = 0;
+            proc->nr_wakeups ++;
             if (proc != current) {
                 sched_class_enqueue(proc);
+                proc->woken = 1;
+                // the classes only preempt a real process; cpu_idle would wait on with the
+                // tick stopped, e.g. after serial input or an hrtimer
+                if (current == idleproc) {
+                    current->need_resched = 1;
+                }
             }
         }
         else {
@@ -124,17 +364,34 @@ schedule(void) {
     local_intr_save(intr_flag);
     {
         current->need_resched = 0;
+        if (current != idleproc) {
+            int why = (current->state != PROC_RUNNABLE) ? SWITCH_BLOCKED
+                : (current->slice_expired ? SWITCH_EXPIRED : SWITCH_PREEMPTED);
+            current->nr_switch[why] ++;
+            schedlat.nr_switch[why] ++;
+        }
+        current->slice_expired = 0;
         if (current->state == PROC_RUNNABLE) {
             sched_class_enqueue(current);
         }
+        else if (current->state == PROC_SLEEPING) {
+            sched_class_proc_block(current);
+        }
         if ((next = sched_class_pick_next()) != NULL) {
             sched_class_dequeue(next);
+            schedlat_account(next);
         }
         if (next == NULL) {
             next = idleproc;
         }
         next->runs ++;
         if (next != current) {
+            if (current->state == PROC_RUNNABLE) {
+                current->nivcsw ++;
+            }
+            else {
+                current->nvcsw ++;
+            }
             //kprintf("########################\n");
             //kprintf("c %d TO %d\n", current->pid, next->pid);
             //print_trapframe(next->tf);
@@ -145,13 +402,63 @@ schedule(void) {
     local_intr_restore(intr_flag);
 }
 
- 
-// 添加timer，如果当前timer的剩余时间小于下一个timer，还会把下一个timer减去当前timer这么多的时间
-// 可是为什么要这样做呢？
+// 内核抢占：计数见 preempt.h，中断返回内核态时的检查在 mips_trap 中
+volatile int preempt_count = 0;
+
+// preempt_check_resched - called when preempt_count drops to 0, preempt current if a wakeup asked for it
+void
+preempt_check_resched(void) {
+    // interrupts off: a trap handler, which must not switch away from under its trapframe
+    if (current != NULL && current != idleproc && current->need_resched
+            && (read_c0_status() & ST0_IE)) {
+        schedule();
+    }
+}
+
+/* *
+ * cond_resched - a voluntary preemption point for long loops that hold a semaphore (and
+ * so are not preemptible), e.g. copy_range under the mm lock. The caller must leave the
+ * data the semaphore protects consistent; sleeping with a semaphore held is fine here.
+ * */
+void
+cond_resched(void) {
+    if (current->need_resched && (read_c0_status() & ST0_IE)) {
+        schedule();
+    }
+}
+
+
+// 添加timer：按到期时间离现在多远，挂到时间轮对应一层的对应槽上
 // 向系统添加某个初始化过的timer_t，该定时器在 指定时间后被激活，并将对应的进程唤醒至runnable（如果当前进程处在等待状态）——手册
- 
 
-// 向链表中添加计时器
+// internal_add_timer - hang timer, expires already absolute, in its slot of the wheel
+static void
+internal_add_timer(timer_t *timer) {
+    size_t expires = timer->expires, idx = expires - timer_jiffies;
+    list_entry_t *vec;
+    if ((int)idx < 0) {
+        // already due (a cascaded timer of the tick being run): run it on the next tick
+        vec = tv1 + (timer_jiffies & TVR_MASK);
+    }
+    else if (idx < TVR_SIZE) {
+        vec = tv1 + (expires & TVR_MASK);
+    }
+    else if (idx < (1 << (TVR_BITS + TVN_BITS))) {
+        vec = tvn[0] + ((expires >> TVR_BITS) & TVN_MASK);
+    }
+    else if (idx < (1 << (TVR_BITS + 2 * TVN_BITS))) {
+        vec = tvn[1] + ((expires >> (TVR_BITS + TVN_BITS)) & TVN_MASK);
+    }
+    else if (idx < (1 << (TVR_BITS + 3 * TVN_BITS))) {
+        vec = tvn[2] + ((expires >> (TVR_BITS + 2 * TVN_BITS)) & TVN_MASK);
+    }
+    else {
+        vec = tvn[3] + ((expires >> (TVR_BITS + 3 * TVN_BITS)) & TVN_MASK);
+    }
+    list_add_before(vec, &(timer->timer_link));
+}
+
+// 向时间轮中添加计时器
  
 void
 add_timer(timer_t *timer) {
@@ -160,45 +467,81 @@ add_timer(timer_t *timer) {
     {
         assert(timer->expires > 0 && timer->proc != NULL);
         assert(list_empty(&(timer->timer_link)));
-        list_entry_t *le = list_next(&timer_list);
-        while (le != &timer_list) {
-            timer_t *next = le2timer(le, timer_link);
-            if (timer->expires < next->expires) {
-                next->expires -= timer->expires;
-                break;
-            }
-            timer->expires -= next->expires;
-            le = list_next(le);
+        if (timer->expires > TIMER_MAX_EXPIRES) {
+            timer->expires = TIMER_MAX_EXPIRES;
         }
-        list_add_before(le, &(timer->timer_link));
+        timer->expires += ticks;
+        internal_add_timer(timer);
     }
     local_intr_restore(intr_flag);
 }
 
  
-// 删除timer，还会把dangqiantimer的剩余时间给下一个timer
-// 可是为什么要这么做呢？
 // 向系统删除（或者说取消）某一个定时器。该定时器在取消后不会被系统激活并唤醒进程——手册
- 
-// 从链表中删除计时器
+// 时间轮里的槽只是链表头，直接摘下来就行
  
 void
 del_timer(timer_t *timer) {
     bool intr_flag;
     local_intr_save(intr_flag);
     {
-        if (!list_empty(&(timer->timer_link))) {
-            if (timer->expires != 0) {
-                list_entry_t *le = list_next(&(timer->timer_link));
-                if (le != &timer_list) {
-                    timer_t *next = le2timer(le, timer_link);
-                    next->expires += timer->expires;
-                }
+        list_del_init(&(timer->timer_link));
+    }
+    local_intr_restore(intr_flag);
+}
+
+// cascade - move the timers of slot index of level n (0 for tv2) down the wheel, return index
+static int
+cascade(int n, int index) {
+    list_entry_t *list = tvn[n] + index, *le;
+    while ((le = list_next(list)) != list) {
+        list_del(le);
+        internal_add_timer(le2timer(le, timer_link));
+    }
+    return index;
+}
+
+/* *
+ * sched_next_event - the ticks from now to the next tick that has work for the timers: a
+ * timer due, or a cascade that may bring timers down into tv1. At least 1 and at most
+ * TVR_SIZE. Called by cpu_idle with interrupts disabled to stop the tick until then.
+ * */
+size_t
+sched_next_event(void) {
+    size_t j = timer_jiffies;
+    while ((j & TVR_MASK) != 0 && list_empty(tv1 + (j & TVR_MASK))) {
+        j ++;
+    }
+    return ((int)(j - ticks) > 1) ? j - ticks : 1;
+}
+
+#define TV_INDEX(n)                     ((timer_jiffies >> (TVR_BITS + (n) * TVN_BITS)) & TVN_MASK)
+
+// run_timers - run the timers due up to ticks, the slots of the ticks missed included
+static void
+run_timers(void) {
+    while ((int)(ticks - timer_jiffies) >= 0) {
+        int index = timer_jiffies & TVR_MASK;
+        if (index == 0 && cascade(0, TV_INDEX(0)) == 0 && cascade(1, TV_INDEX(1)) == 0
+                && cascade(2, TV_INDEX(2)) == 0) {
+            cascade(3, TV_INDEX(3));
+        }
+        timer_jiffies ++;
+
+        list_entry_t *list = tv1 + index, *le;
+        while ((le = list_next(list)) != list) {
+            timer_t *timer = le2timer(le, timer_link);
+            struct proc_struct *proc = timer->proc;
+            list_del_init(le);
+            if (proc->wait_state != 0) {
+                assert(proc->wait_state & WT_INTERRUPTED);
+            }
+            else {
+                warn("process %d's wait_state == 0.\n", proc->pid);
             }
-            list_del_init(&(timer->timer_link));
+            wakeup_proc(proc);
         }
     }
-    local_intr_restore(intr_flag);
 }
 
 // run_timer_list函数在每次timer中断处理过程中被调用，从而可用来调用调度算法所需的timer时间事件感知操作，
@@ -206,33 +549,17 @@ del_timer(timer_t *timer) {
 // 简而言之是timer到期了就wakeup_proc，然后不管到没到期都调用sched_class_proc_tick
 // 更新当前系统时间点，遍历当前所有处在系统管理内的定时器，找出所有应该激活的计数器，
 // 并激活它们。该过程在且只在每次定时器中断时被调用。在ucore 中，其还会调用调度器事件处理程序——实验手册
+// run_timer_list - TIMER_SOFTIRQ: the wheel is only changed by softirqs, which do not nest
+//                - and cannot be preempted, and by process context with interrupts off,
+//                - so it is walked with interrupts on; the run queue is not, it is also
+//                - used by the hrtimers in the interrupt itself
 void
 run_timer_list(void) {
     bool intr_flag;
+    run_timers();
     local_intr_save(intr_flag);
     {
-        list_entry_t *le = list_next(&timer_list);
-        if (le != &timer_list) {
-            timer_t *timer = le2timer(le, timer_link);
-            assert(timer->expires != 0);
-            timer->expires --;
-            while (timer->expires == 0) {
-                le = list_next(le);
-                struct proc_struct *proc = timer->proc;
-                if (proc->wait_state != 0) {
-                    assert(proc->wait_state & WT_INTERRUPTED);
-                }
-                else {
-                    warn("process %d's wait_state == 0.\n", proc->pid);
-                }
-                wakeup_proc(proc);
-                del_timer(timer);
-                if (le == &timer_list) {
-                    break;
-                }
-                timer = le2timer(le, timer_link);
-            }
-        }
+        rqlen_sample();
         sched_class_proc_tick(current);
     }
     local_intr_restore(intr_flag);
@@ -5,9 +5,12 @@
 
 #include <defs.h>
 #include <list.h>
-//#include <skew_heap.h>
+#include <rb_tree.h>
+#include <procinfo.h>
 
 struct proc_struct;
+struct schedstat;
+struct schedlat;
 
 // timer结构体，有让它可以被加入list的le，还有时间、指向进程的指针
 typedef struct {
@@ -47,6 +50,9 @@ struct sched_class {
     struct proc_struct *(*pick_next)(struct run_queue *rq);
     // dealer of the time-tick
     void (*proc_tick)(struct run_queue *rq, struct proc_struct *proc);
+    // the running proc is going to sleep waiting for a timer, the keyboard or a semaphore;
+    // optional, NULL if the class does not care
+    void (*proc_block)(struct run_queue *rq, struct proc_struct *proc);
 	/* for SMP support in the future
 	 *  load_balance
 	 *	 void (*load_balance)(struct rq* rq);
@@ -56,11 +62,39 @@ struct sched_class {
 	 */
 };
 
+#define MLFQ_NLEVEL             4           // # of levels of mlfq_sched_class
+#define MLFQ_SLICE_MIN          2           // the time slice of level 0, doubled at each level down
+#define MLFQ_BOOST_INTERVAL     100         // ticks between two boosts of all processes to the top
+
+// fair_sched_class, the vruntime of a tick of CPU time at nice 0 is 1024
+#define FAIR_MIN_GRANULARITY    2           // ticks a process runs at least before it is preempted
+#define FAIR_SCHED_GRAN         (2 << 10)   // how far current may get ahead of the leftmost
+#define FAIR_WAKEUP_GRAN        (1 << 10)   // how far a woken process must be behind current to preempt it
+#define FAIR_SLEEPER_CREDIT     (3 << 10)   // how far before min_vruntime a woken process may start
+
+// rt_sched_class
+#define RT_RR_SLICE             4           // the time slice of a SCHED_RR process
+#define RT_PERIOD               100         // ticks in a throttling period
+#define RT_RUNTIME              95          // the ticks real time processes may use in a period
+
 // 名字叫队列，其实只是一个列表，两个列表的属性集合在一起而已
 struct run_queue {
     list_entry_t run_list;  // 双向列表
     unsigned int proc_num;  // 列表中进程数
     int max_time_slice;     // 最大事件片
+    // for mlfq_sched_class
+    list_entry_t mlfq_list[MLFQ_NLEVEL];    // one list per level, level 0 first
+    int mlfq_boost;                         // ticks until the next boost
+    uint32_t mlfq_gen;                      // # of boosts so far
+    // for fair_sched_class
+    rb_tree *fair_tree;                     // the runnable processes by vruntime
+    uint32_t fair_min_vruntime;             // never decreases, see fair_update_min
+    // for rt_sched_class
+    list_entry_t rt_list[RT_PRIO_MAX];      // one list per priority
+    uint32_t rt_bitmap;                     // bit p is set if rt_list[p] is not empty
+    int rt_time;                            // ticks used by real time processes in this period
+    int rt_period_left;                     // ticks until the period ends
+    bool rt_throttled;                      // rt_time reached RT_RUNTIME in this period
 };
 
 void sched_init(void);
@@ -69,5 +103,10 @@ void schedule(void);
 void add_timer(timer_t *timer);
 void del_timer(timer_t *timer);
 void run_timer_list(void);
+size_t sched_next_event(void);
+int cputime_switch(int mode);
+void schedstat_fill(struct schedstat *stat, struct proc_struct *proc);
+void schedlat_read(struct schedlat *lat, bool reset);
+void sched_setscheduler(struct proc_struct *proc, int policy, int rt_priority);
 
 #endif /* !__KERN_SCHEDULE_SCHED_H__ */
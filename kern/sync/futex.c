@@ -0,0 +1,133 @@
+// futex：按用户虚拟地址睡眠与唤醒，用户态的锁只在有竞争时才进入内核
+
+#include <defs.h>
+#include <wait.h>
+#include <sync.h>
+#include <stdlib.h>
+#include <error.h>
+#include <unistd.h>
+#include <proc.h>
+#include <vmm.h>
+#include <sched.h>
+#include <futex.h>
+
+/* A futex is an aligned int in user memory, named by the mm and its user address, so
+   only the threads of one process (CLONE_VM) share it. The waiters of all futexes are
+   kept in futex_queue[], hashed by that key; a struct futex_wait on the stack of the
+   sleeping thread remembers which futex it waits on.
+
+   The check of the value in FUTEX_WAIT and the sleep happen under lock_mm, where the
+   waiter cannot be preempted, so a FUTEX_WAKE after the user changed the value cannot
+   be lost. */
+
+struct futex_wait {
+    wait_t wait;
+    struct mm_struct *mm;
+    uintptr_t uaddr;
+};
+
+static wait_queue_t futex_queue[1 << FUTEX_HASH_SHIFT];
+
+#define futex_hashfn(mm, uaddr)                                 \
+    (futex_queue + hash32((uintptr_t)(uaddr) ^ (uintptr_t)(mm), FUTEX_HASH_SHIFT))
+
+void
+futex_init(void) {
+    int i;
+    for (i = 0; i < (1 << FUTEX_HASH_SHIFT); i ++) {
+        wait_queue_init(futex_queue + i);
+    }
+}
+
+// futex_wait - sleep while *uaddr == val, until a FUTEX_WAKE on uaddr or a kill
+static int
+futex_wait(struct mm_struct *mm, uintptr_t uaddr, int val) {
+    wait_queue_t *queue = futex_hashfn(mm, uaddr);
+    struct futex_wait __fw, *fw = &__fw;
+    bool intr_flag;
+    int cur;
+
+    lock_mm(mm);
+    if (!copy_from_user(mm, &cur, (void *)uaddr, sizeof(int), 0)) {
+        unlock_mm(mm);
+        return -E_FAULT;
+    }
+    if (cur != val) {
+        unlock_mm(mm);
+        return 0;
+    }
+    fw->mm = mm, fw->uaddr = uaddr;
+    local_intr_save(intr_flag);
+    wait_current_set(queue, &(fw->wait), WT_FUTEX);
+    local_intr_restore(intr_flag);
+    unlock_mm(mm);
+
+    schedule();
+
+    local_intr_save(intr_flag);
+    wait_current_del(queue, &(fw->wait));
+    local_intr_restore(intr_flag);
+    return (fw->wait.wakeup_flags == WT_FUTEX) ? 0 : -E_KILLED;
+}
+
+// futex_wake - wake at most n threads waiting on uaddr, return the number woken
+static int
+futex_wake(struct mm_struct *mm, uintptr_t uaddr, int n) {
+    wait_queue_t *queue = futex_hashfn(mm, uaddr);
+    wait_t *wait, *next;
+    int woken = 0;
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        for (wait = wait_queue_first(queue); wait != NULL && woken < n; wait = next) {
+            struct futex_wait *fw = to_struct(wait, struct futex_wait, wait);
+            next = wait_queue_next(queue, wait);
+            if (fw->mm == mm && fw->uaddr == uaddr) {
+                wakeup_wait(queue, wait, WT_FUTEX, 1);
+                woken ++;
+            }
+        }
+    }
+    local_intr_restore(intr_flag);
+    return woken;
+}
+
+/* *
+ * futex_cmpxchg - if *uaddr == val, set it to val2; return the old value. This stands in
+ * for the compare-and-swap instruction the CPU does not have.
+ * */
+static int
+futex_cmpxchg(struct mm_struct *mm, uintptr_t uaddr, int val, int val2) {
+    int cur, ret;
+    lock_mm(mm);
+    if (!copy_from_user(mm, &cur, (void *)uaddr, sizeof(int), 1)) {
+        ret = -E_FAULT;
+    }
+    else if (cur == val && !copy_to_user(mm, (void *)uaddr, &val2, sizeof(int))) {
+        ret = -E_FAULT;
+    }
+    else {
+        ret = cur;
+    }
+    unlock_mm(mm);
+    return ret;
+}
+
+// do_futex - called by sys_futex, see FUTEX_* in unistd.h
+int
+do_futex(uintptr_t uaddr, int op, int val, int val2) {
+    struct mm_struct *mm = current->mm;
+    if (mm == NULL || (uaddr & (sizeof(int) - 1)) != 0) {
+        return -E_INVAL;
+    }
+    switch (op) {
+    case FUTEX_WAIT:
+        return futex_wait(mm, uaddr, val);
+    case FUTEX_WAKE:
+        return futex_wake(mm, uaddr, val);
+    case FUTEX_CMPXCHG:
+        return futex_cmpxchg(mm, uaddr, val, val2);
+    }
+    return -E_INVAL;
+}
+
@@ -0,0 +1,14 @@
+// futex（快速用户态互斥）的接口定义
+
+#ifndef __KERN_SYNC_FUTEX_H__
+#define __KERN_SYNC_FUTEX_H__
+
+#include <defs.h>
+
+#define FUTEX_HASH_SHIFT            6
+
+void futex_init(void);
+int do_futex(uintptr_t uaddr, int op, int val, int val2);
+
+#endif /* !__KERN_SYNC_FUTEX_H__ */
+
@@ -0,0 +1,43 @@
+// 内核抢占计数：计数不为 0 时，中断返回内核态不会切换进程
+
+#ifndef __KERN_SYNC_PREEMPT_H__
+#define __KERN_SYNC_PREEMPT_H__
+
+#include <defs.h>
+
+/* *
+ * preempt_count - # of reasons the running process must not be preempted: one for every
+ * local_intr_save region it is in and every semaphore it holds. It belongs to the running
+ * process; proc_run saves it in the proc_struct of prev and loads the one of next, so a
+ * process that sleeps while holding a semaphore gets its count back when it runs again.
+ *
+ * The increments are not atomic, but an interrupt always gives the count back as it found
+ * it, and a process is only preempted when the count is 0.
+ * */
+extern volatile int preempt_count;
+
+void preempt_check_resched(void);
+void cond_resched(void);
+
+#define preempt_disable()                   \
+    do {                                    \
+        preempt_count ++;                   \
+    } while (0)
+
+#define preempt_enable_no_resched()         \
+    do {                                    \
+        preempt_count --;                   \
+    } while (0)
+
+// a wakeup that came while the count was held did not preempt anybody, do it now
+#define preempt_enable()                    \
+    do {                                    \
+        if (-- preempt_count == 0) {        \
+            preempt_check_resched();        \
+        }                                   \
+    } while (0)
+
+#define preemptible()                       (preempt_count == 0)
+
+#endif /* !__KERN_SYNC_PREEMPT_H__ */
+
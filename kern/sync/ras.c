@@ -0,0 +1,94 @@
+// 可重启原子序列：被打断在序列中间的用户线程从序列开头重新执行
+
+#include <defs.h>
+#include <kmalloc.h>
+#include <string.h>
+#include <error.h>
+#include <assert.h>
+#include <proc.h>
+#include <vmm.h>
+#include <ras.h>
+
+/* The CPU has no LL/SC and user mode cannot disable interrupts, so user atomics are
+   short code sequences that load, compute and end with one store. A process registers
+   them with SYS_ras; mips_trap calls ras_restart on every interrupt or exception from
+   user mode, and a thread stopped inside a sequence (before its store has been done)
+   is moved back to the start of it. Whatever ran in between, the sequence then loads
+   again, so it takes effect as a whole or not at all.
+
+   The sequences belong to the mm: threads share them, fork copies them and exec drops
+   them. A sequence must not make a syscall, since it would be restarted forever. */
+
+// do_ras - called by sys_ras: register [start, start + len) of current as a sequence
+int
+do_ras(uintptr_t start, size_t len) {
+    struct mm_struct *mm = current->mm;
+    struct vma_struct *vma;
+    if (mm == NULL || len == 0 || len > RAS_MAX_LEN || (start & 3) != 0 || (len & 3) != 0) {
+        return -E_INVAL;
+    }
+    if (!USER_ACCESS(start, start + len)) {
+        return -E_INVAL;
+    }
+
+    int i, ret = -E_INVAL;
+    lock_mm(mm);
+    if ((vma = find_vma(mm, start)) == NULL || start + len > vma->vm_end || !(vma->vm_flags & VM_EXEC)) {
+        goto out_unlock;
+    }
+    ret = -E_NO_MEM;
+    if (mm->ras == NULL) {
+        if ((mm->ras = kmalloc(sizeof(struct ras_set))) == NULL) {
+            goto out_unlock;
+        }
+        mm->ras->nr = 0;
+    }
+    struct ras_set *ras = mm->ras;
+    for (i = 0; i < ras->nr; i ++) {
+        if (ras->range[i].start == start && ras->range[i].end == start + len) {
+            ret = 0;
+            goto out_unlock;
+        }
+    }
+    ret = -E_MAX_OPEN;
+    if (ras->nr < RAS_MAX) {
+        ras->range[ras->nr].start = start;
+        ras->range[ras->nr].end = start + len;
+        ras->nr ++, ret = 0;
+    }
+out_unlock:
+    unlock_mm(mm);
+    return ret;
+}
+
+// dup_ras - give the child of a fork the sequences of its parent
+int
+dup_ras(struct mm_struct *to, struct mm_struct *from) {
+    assert(to->ras == NULL);
+    if (from->ras != NULL) {
+        if ((to->ras = kmalloc(sizeof(struct ras_set))) == NULL) {
+            return -E_NO_MEM;
+        }
+        memcpy(to->ras, from->ras, sizeof(struct ras_set));
+    }
+    return 0;
+}
+
+// ras_restart - tf is the trapframe of a trap from user mode, rewind it to the start of
+//             - the sequence it stopped in
+void
+ras_restart(struct trapframe *tf) {
+    struct ras_set *ras;
+    if (current->mm == NULL || (ras = current->mm->ras) == NULL) {
+        return ;
+    }
+    uintptr_t epc = tf->tf_epc;
+    int i;
+    for (i = 0; i < ras->nr; i ++) {
+        if (ras->range[i].start < epc && epc < ras->range[i].end) {
+            tf->tf_epc = ras->range[i].start;
+            return ;
+        }
+    }
+}
+
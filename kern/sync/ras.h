@@ -0,0 +1,27 @@
+// 可重启原子序列（restartable atomic sequences）的接口定义
+
+#ifndef __KERN_SYNC_RAS_H__
+#define __KERN_SYNC_RAS_H__
+
+#include <defs.h>
+#include <trap.h>
+
+#define RAS_MAX                     16          // # of sequences a process may register
+#define RAS_MAX_LEN                 64          // the longest sequence, in bytes
+
+struct mm_struct;
+
+// the sequences of an mm, kmalloc'ed on the first registration
+struct ras_set {
+    int nr;
+    struct {
+        uintptr_t start, end;   // [start, end) of the code, end is after the committing store
+    } range[RAS_MAX];
+};
+
+int do_ras(uintptr_t start, size_t len);
+int dup_ras(struct mm_struct *to, struct mm_struct *from);
+void ras_restart(struct trapframe *tf);
+
+#endif /* !__KERN_SYNC_RAS_H__ */
+
@@ -60,15 +60,18 @@ static __noinline uint32_t __down(semaphore_t *sem, uint32_t wait_state) {
     return 0;
 }
 
+// 内核信号量都当互斥锁用，持有期间不可抢占（见 preempt.h）
 void
 up(semaphore_t *sem) {
     __up(sem, WT_KSEM);
+    preempt_enable();
 }
 
 void
 down(semaphore_t *sem) {
     uint32_t flags = __down(sem, WT_KSEM);
     assert(flags == 0);
+    preempt_disable();
 }
 
 bool
@@ -77,6 +80,7 @@ try_down(semaphore_t *sem) {
     local_intr_save(intr_flag);
     if (sem->value > 0) {
         sem->value --, ret = 1;
+        preempt_disable();
     }
     local_intr_restore(intr_flag);
     return ret;
@@ -8,6 +8,11 @@
 #include <stat.h>
 #include <dirent.h>
 #include <sysfile.h>
+#include <alloc_prof.h>
+#include <irqsoff.h>
+#include <futex.h>
+#include <ras.h>
+#include <error.h>
 
 extern volatile int ticks;
 
@@ -17,6 +22,12 @@ extern volatile int ticks;
 
 static int
 sys_exit(uint32_t arg[]) {
+    int error_code = (int)arg[0];
+    return do_exit_group(error_code);
+}
+
+static int
+sys_exit_thread(uint32_t arg[]) {
     int error_code = (int)arg[0];
     return do_exit(error_code);
 }
@@ -28,6 +39,15 @@ sys_fork(uint32_t arg[]) {
     return do_fork(0, stack, tf);
 }
 
+static int
+sys_clone(uint32_t arg[]) {
+    uint32_t clone_flags = (uint32_t)arg[0];
+    uintptr_t stack = (uintptr_t)arg[1];
+    uintptr_t entry = (uintptr_t)arg[2];
+    uintptr_t entry_arg = (uintptr_t)arg[3];
+    return do_clone(clone_flags, stack, entry, entry_arg);
+}
+
 static int
 sys_wait(uint32_t arg[]) {
     int pid = (int)arg[0];
@@ -43,6 +63,31 @@ sys_exec(uint32_t arg[]) {
     return do_execve(name, argc, argv);
 }
 
+static int
+sys_spawn(uint32_t arg[]) {
+    int argc = (int)arg[0];
+    const char **argv = (const char **)arg[1];
+    int fd_in = (int)arg[2];
+    int fd_out = (int)arg[3];
+    return do_spawn(argc, argv, fd_in, fd_out);
+}
+
+static int
+sys_futex(uint32_t arg[]) {
+    uintptr_t uaddr = (uintptr_t)arg[0];
+    int op = (int)arg[1];
+    int val = (int)arg[2];
+    int val2 = (int)arg[3];
+    return do_futex(uaddr, op, val, val2);
+}
+
+static int
+sys_ras(uint32_t arg[]) {
+    uintptr_t start = (uintptr_t)arg[0];
+    size_t len = (size_t)arg[1];
+    return do_ras(start, len);
+}
+
 static int
 sys_yield(uint32_t arg[]) {
     return do_yield();
@@ -72,6 +117,64 @@ sys_pgdir(uint32_t arg[]) {
     return 0;
 }
 
+static int
+sys_allocprof(uint32_t arg[]) {
+    int op = (int)arg[0];
+    switch (op) {
+    case ALLOCPROF_PRINT: alloc_prof_print(); break;
+    case ALLOCPROF_RESET: alloc_prof_reset(); break;
+    default: return -E_INVAL;
+    }
+    return 0;
+}
+
+static int
+sys_procinfo(uint32_t arg[]) {
+    struct procinfo *buf = (struct procinfo *)arg[0];
+    int n = (int)arg[1];
+    return do_procinfo(buf, n);
+}
+
+static int
+sys_nice(uint32_t arg[]) {
+    int pid = (int)arg[0];
+    int nice = (int)arg[1];
+    return do_nice(pid, nice);
+}
+
+static int
+sys_sched_setscheduler(uint32_t arg[]) {
+    int pid = (int)arg[0];
+    int policy = (int)arg[1];
+    int rt_priority = (int)arg[2];
+    return do_sched_setscheduler(pid, policy, rt_priority);
+}
+
+static int
+sys_schedstat(uint32_t arg[]) {
+    int pid = (int)arg[0];
+    struct schedstat *stat = (struct schedstat *)arg[1];
+    return do_schedstat(pid, stat);
+}
+
+static int
+sys_schedlat(uint32_t arg[]) {
+    struct schedlat *lat = (struct schedlat *)arg[0];
+    int flags = (int)arg[1];
+    return do_schedlat(lat, flags);
+}
+
+static int
+sys_irqsoff(uint32_t arg[]) {
+    int op = (int)arg[0];
+    switch (op) {
+    case IRQSOFF_PRINT: irqsoff_print(); break;
+    case IRQSOFF_RESET: irqsoff_reset(); break;
+    default: return -E_INVAL;
+    }
+    return 0;
+}
+
 static int
 sys_gettime(uint32_t arg[]) {
     return (int)ticks;
@@ -83,6 +186,19 @@ sys_sleep(uint32_t arg[]) {
     return do_sleep(time);
 }
 
+static int
+sys_nanosleep(uint32_t arg[]) {
+    const struct timespec *req = (const struct timespec *)arg[0];
+    return do_nanosleep(req);
+}
+
+static int
+sys_clock_gettime(uint32_t arg[]) {
+    int clock = (int)arg[0];
+    struct timespec *ts = (struct timespec *)arg[1];
+    return do_clock_gettime(clock, ts);
+}
+
 static int
 sys_open(uint32_t arg[]) {
     const char *path = (const char *)arg[0];
@@ -160,21 +276,41 @@ sys_dup(uint32_t arg[]) {
     int fd2 = (int)arg[1];
     return sysfile_dup(fd1, fd2);
 }
+
+static int
+sys_lab6_set_priority(uint32_t arg[]) {
+    uint32_t priority = (uint32_t)arg[0];
+    return do_set_priority(priority);
+}
 // 以上为系统调用入口函数的实现
 
 // 系统调用号与对应函数的map
 static int (*syscalls[])(uint32_t arg[]) = {
   [SYS_exit]              sys_exit,
   [SYS_fork]              sys_fork,
+  [SYS_clone]             sys_clone,
   [SYS_wait]              sys_wait,
   [SYS_exec]              sys_exec,
+  [SYS_spawn]             sys_spawn,
+  [SYS_exit_thread]       sys_exit_thread,
+  [SYS_futex]             sys_futex,
+  [SYS_ras]               sys_ras,
   [SYS_yield]             sys_yield,
   [SYS_kill]              sys_kill,
+  [SYS_nice]              sys_nice,
+  [SYS_sched_setscheduler] sys_sched_setscheduler,
   [SYS_getpid]            sys_getpid,
   [SYS_putc]              sys_putc,
   [SYS_pgdir]             sys_pgdir,
+  [SYS_allocprof]         sys_allocprof,
+  [SYS_procinfo]          sys_procinfo,
+  [SYS_schedstat]         sys_schedstat,
+  [SYS_irqsoff]           sys_irqsoff,
+  [SYS_schedlat]          sys_schedlat,
   [SYS_gettime]           sys_gettime,
   [SYS_sleep]             sys_sleep,
+  [SYS_nanosleep]         sys_nanosleep,
+  [SYS_clock_gettime]     sys_clock_gettime,
   [SYS_open]              sys_open,
   [SYS_close]             sys_close,
   [SYS_read]              sys_read,
@@ -185,6 +321,7 @@ static int (*syscalls[])(uint32_t arg[]) = {
   [SYS_getcwd]            sys_getcwd,
   [SYS_getdirentry]       sys_getdirentry,
   [SYS_dup]               sys_dup,
+  [SYS_lab6_set_priority] sys_lab6_set_priority,
 };
 
 #define NUM_SYSCALLS        ((sizeof(syscalls)) / (sizeof(syscalls[0])))
@@ -0,0 +1,116 @@
+// 中断底半部（softirq / tasklet）：中断处理只应答设备，其余工作在最外层中断返回前开着中断完成
+
+#include <defs.h>
+#include <list.h>
+#include <sync.h>
+#include <stdio.h>
+#include <assert.h>
+#include <softirq.h>
+
+/* An interrupt handler (the top half) only does what cannot wait: it acknowledges the
+   device, saves what it read, and raises a softirq. mips_trap calls do_softirq on the way
+   out of an interrupt, and do_softirq runs the pending softirqs with interrupts enabled,
+   so another interrupt, e.g. the next timer one, is taken at once. cpu_idle also calls it,
+   for the work left over by the budgets below.
+
+   Softirqs do not nest: one that is interrupted leaves the bits raised meanwhile to the
+   do_softirq it is in. They run with preemption disabled (do_softirq keeps its
+   local_intr_save count while it turns interrupts on), so process context never sees
+   one half done, and data shared only by process context and softirqs needs no more
+   than the local_intr_save the process side takes already.
+
+   A burst cannot hold the CPU forever: do_softirq gives up after SOFTIRQ_MAX_RESTART
+   rounds, TASKLET_SOFTIRQ runs at most TASKLET_BUDGET tasklets, and a tasklet has a
+   budget of its own. Whatever is left stays pending for the next interrupt. */
+
+volatile uint32_t softirq_pending;
+static void (*softirq_vec[NR_SOFTIRQS])(void);
+static bool softirq_running;
+
+static list_entry_t tasklet_list;
+
+// open_softirq - set the function that runs softirq nr
+void
+open_softirq(int nr, void (*action)(void)) {
+    assert(nr >= 0 && nr < NR_SOFTIRQS && softirq_vec[nr] == NULL);
+    softirq_vec[nr] = action;
+}
+
+// raise_softirq - mark softirq nr pending, it runs at the latest on the next interrupt exit
+void
+raise_softirq(int nr) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    softirq_pending |= (1 << nr);
+    local_intr_restore(intr_flag);
+}
+
+// do_softirq - run the pending softirqs with interrupts enabled; nothing if one is running
+void
+do_softirq(void) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    if (!softirq_running) {
+        softirq_running = 1;
+        int restart = SOFTIRQ_MAX_RESTART;
+        uint32_t pending;
+        while ((pending = softirq_pending) != 0 && restart -- > 0) {
+            softirq_pending = 0;
+            intr_enable();
+            int nr;
+            for (nr = 0; nr < NR_SOFTIRQS; nr ++) {
+                if (pending & (1 << nr)) {
+                    softirq_vec[nr]();
+                }
+            }
+            intr_disable();
+        }
+        softirq_running = 0;
+    }
+    local_intr_restore(intr_flag);
+}
+
+// tasklet_schedule - run t in TASKLET_SOFTIRQ, once even if it is scheduled again before
+void
+tasklet_schedule(tasklet_t *t) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    if (!t->scheduled) {
+        t->scheduled = 1;
+        list_add_before(&tasklet_list, &(t->tasklet_link));
+        softirq_pending |= (1 << TASKLET_SOFTIRQ);
+    }
+    local_intr_restore(intr_flag);
+}
+
+// tasklet_action - TASKLET_SOFTIRQ: run the tasklets in the order they were scheduled
+static void
+tasklet_action(void) {
+    int budget = TASKLET_BUDGET;
+    bool intr_flag;
+    while (budget -- > 0) {
+        tasklet_t *t = NULL;
+        local_intr_save(intr_flag);
+        if (!list_empty(&tasklet_list)) {
+            t = le2tasklet(list_next(&tasklet_list), tasklet_link);
+            list_del_init(&(t->tasklet_link));
+            // cleared first: func may schedule t again
+            t->scheduled = 0;
+        }
+        local_intr_restore(intr_flag);
+        if (t == NULL) {
+            return ;
+        }
+        t->func(t->data);
+    }
+    if (!list_empty(&tasklet_list)) {
+        raise_softirq(TASKLET_SOFTIRQ);
+    }
+}
+
+void
+softirq_init(void) {
+    list_init(&tasklet_list);
+    open_softirq(TASKLET_SOFTIRQ, tasklet_action);
+}
+
@@ -0,0 +1,46 @@
+#ifndef __KERN_TRAP_SOFTIRQ_H__
+#define __KERN_TRAP_SOFTIRQ_H__
+
+#include <defs.h>
+#include <list.h>
+
+// the bottom halves, run in this order; a pending bit each in softirq_pending
+enum {
+    TIMER_SOFTIRQ,                      // the timing wheel and the scheduler tick (run_timer_list)
+    TASKLET_SOFTIRQ,                    // the tasklets, e.g. the serial input
+    NR_SOFTIRQS,
+};
+
+#define SOFTIRQ_MAX_RESTART     4       // rounds of do_softirq before the rest waits for the next trap
+#define TASKLET_BUDGET          8       // tasklets run by one TASKLET_SOFTIRQ
+
+// a tasklet: func(data) runs once in TASKLET_SOFTIRQ however often it is scheduled before
+typedef struct {
+    void (*func)(void *data);
+    void *data;
+    bool scheduled;
+    list_entry_t tasklet_link;
+} tasklet_t;
+
+#define le2tasklet(le, member)          \
+    to_struct((le), tasklet_t, member)
+
+static inline tasklet_t *
+tasklet_init(tasklet_t *t, void (*func)(void *), void *data) {
+    t->func = func;
+    t->data = data;
+    t->scheduled = 0;
+    list_init(&(t->tasklet_link));
+    return t;
+}
+
+extern volatile uint32_t softirq_pending;
+
+void softirq_init(void);
+void open_softirq(int nr, void (*action)(void));
+void raise_softirq(int nr);
+void do_softirq(void);
+void tasklet_schedule(tasklet_t *t);
+
+#endif /* !__KERN_TRAP_SOFTIRQ_H__ */
+
@@ -15,6 +15,13 @@
 #include <error.h>
 #include <syscall.h>
 #include <proc.h>
+#include <vmm.h>
+#include <zswap.h>
+#include <ras.h>
+#include <sched.h>
+#include <intr.h>
+#include <softirq.h>
+#include <irqsoff.h>
 
 #define TICK_NUM 100
 
@@ -113,6 +120,7 @@ static void interrupt_handler(struct trapframe *tf)
 }
 
 extern pde_t *current_pgdir;
+extern char __cpu_wait_start[], __cpu_wait_end[];
 
 
 
@@ -176,16 +184,28 @@ static void handle_tlbmiss(struct trapframe* tf, int write)
   uint32_t badaddr = tf->tf_vaddr;
   int ret = 0;
   pte_t *pte = get_pte(current_pgdir, tf->tf_vaddr, 0);
-  if(pte==NULL || ptep_invalid(pte)){   //PTE miss, pgfault
+  if(pte==NULL || !ptep_present(pte)     //PTE miss (or page in zswap), pgfault
+      || (write && !ptep_s_write(pte))){  //or write to a read-only page, do_pgfault copies it if ksm merged it
     //panic("unimpl");
     //TODO
     //tlb will not be refill in do_pgfault,
     //so a vmm pgfault will trigger 2 exception
     //permission check in tlb miss
     ret = pgfault_handler(tf, badaddr, get_error_code(write, pte));
+    /* refill the new mapping now instead of taking a second tlb miss for it */
+    if(ret == 0 && (pte = get_pte(current_pgdir, badaddr, 0)) != NULL
+        && ptep_present(pte) && (!write || ptep_s_write(pte))){
+      ptep_set_accessed(pte);
+      tlb_refill(badaddr, pte);
+    }
   }else{ //tlb miss only, reload it
     /* refill two slot */
     /* check permission */
+    /* software accessed bit, used by the zswap reclaim scan */
+    ptep_set_accessed(pte);
+    if(*pte & PTE_FA){
+      fault_around_touch(pte);
+    }
     if(in_kernel){
       tlb_refill(badaddr, pte); 
     //kprintf("## refill K\n");
@@ -230,6 +250,9 @@ trap_dispatch(struct trapframe *tf) {
     case EX_TLBS:
       handle_tlbmiss(tf, 1);
       break;
+    case EX_MOD:  /* store through a tlb entry without D, i.e. a read-only page */
+      handle_tlbmiss(tf, 1);
+      break;
     case EX_RI:
       print_trapframe(tf);
       if(trap_in_kernel(tf)) {
@@ -254,7 +277,10 @@ trap_dispatch(struct trapframe *tf) {
     case EX_SYS:
       //print_trapframe(tf);
       tf->tf_epc += 4;
+      // 系统调用开着中断执行，时钟中断来了可以抢占它；返回前（exception_return）要关中断
+      intr_enable();
       syscall();
+      intr_disable();
       break;
       /* alignment error or access kernel
        * address space in user mode */
@@ -284,6 +310,10 @@ trap_dispatch(struct trapframe *tf) {
   void
 mips_trap(struct trapframe *tf)
 {
+  // the exception turned interrupts off, they come back with the eret
+  if (IRQSOFF_TRACE && (tf->tf_status & ST0_IE)) {
+    irqsoff_start(IRQSOFF_SITE_TRAP(GET_CAUSE_EXCODE(tf->tf_cause)));
+  }
   // dispatch based on what type of trap occurred
   // used for previous projects
   if (current == NULL) {
@@ -295,18 +325,46 @@ mips_trap(struct trapframe *tf)
     current->tf = tf;
 
     bool in_kernel = trap_in_kernel(tf);
+    bool irq = (GET_CAUSE_EXCODE(tf->tf_cause) == EX_IRQ);
+    // the time until now was spent where tf was interrupted: user mode, or omode
+    int omode = cputime_switch(irq ? CPUTIME_IRQ : CPUTIME_SYS);
+    // a user thread stopped inside a restartable atomic sequence starts it again
+    if (!in_kernel && GET_CAUSE_EXCODE(tf->tf_cause) != EX_SYS) {
+      ras_restart(tf);
+    }
+    // the interrupt may have set need_resched after cpu_wait checked it: do not wait
+    if (in_kernel && irq && tf->tf_epc >= (uintptr_t)__cpu_wait_start
+        && tf->tf_epc < (uintptr_t)__cpu_wait_end) {
+      tf->tf_epc = (uintptr_t)__cpu_wait_end;
+    }
 
     trap_dispatch(tf);
+    // the bottom halves of the interrupt, with interrupts on; still charged as irq time
+    if (irq) {
+      do_softirq();
+    }
+    cputime_switch(in_kernel ? omode : CPUTIME_SYS);
 
     current->tf = otf;
     if (!in_kernel) {
       if (current->flags & PF_EXITING) {
         do_exit(-E_KILLED);
       }
+      zswap_balance();
       if (current->need_resched) {
         schedule();
       }
+      cputime_switch(CPUTIME_USER);
     }
+    // kernel preemption: an interrupt woke somebody who should run before current, and
+    // current holds no semaphore and is in no local_intr_save region. idleproc looks at
+    // need_resched itself.
+    else if (irq && current->need_resched && preemptible() && current != idleproc) {
+      schedule();
+    }
+  }
+  if (IRQSOFF_TRACE && (tf->tf_status & ST0_IE)) {
+    irqsoff_stop((uintptr_t)__builtin_return_address(0));
   }
 }
 
@@ -0,0 +1,20 @@
+#!/bin/sh
+# allocprof.sh - put function and source line next to every call site of an allocprof dump
+# usage: tools/allocprof.sh [kernel-elf] < dump
+#   kernel-elf defaults to obj/ucore-kernel-initrd, the kernel the dump was taken on
+#   ADDR2LINE defaults to the addr2line of the toolchain in the Makefile
+ELF=${1:-obj/ucore-kernel-initrd}
+ADDR2LINE=${ADDR2LINE:-mipsel-linux-gnu-addr2line}
+
+while read -r kind caller rest; do
+    case "$kind" in
+    kmalloc|pages|other)
+        # the return address is the instruction after the delay slot of the jal
+        where=$($ADDR2LINE -f -s -e "$ELF" "$(printf '%x' $((0x$caller - 8)))" | paste -sd ' ' -)
+        printf '  %-8s %s %s  %s\n' "$kind" "$caller" "$rest" "$where"
+        ;;
+    *)
+        echo "$kind $caller $rest"
+        ;;
+    esac
+done
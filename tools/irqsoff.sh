@@ -0,0 +1,24 @@
+#!/bin/sh
+# irqsoff.sh - put function and source line next to the sites of an irqsoff dump
+# usage: tools/irqsoff.sh [kernel-elf] < dump
+#   kernel-elf defaults to obj/ucore-kernel-initrd, the kernel the dump was taken on
+#   ADDR2LINE defaults to the addr2line of the toolchain in the Makefile
+ELF=${1:-obj/ucore-kernel-initrd}
+ADDR2LINE=${ADDR2LINE:-mipsel-linux-gnu-addr2line}
+
+while read -r what site rest; do
+    case "$what:$site" in
+    start:trap|stop:trap)
+        # interrupts went off at an exception with this exception code
+        echo "  $what $site $rest"
+        ;;
+    start:*|stop:*)
+        # the return address of intr_disable / intr_enable, after the delay slot of the jal
+        where=$($ADDR2LINE -f -s -e "$ELF" "$(printf '%x' $((0x$site - 8)))" | paste -sd ' ' -)
+        printf '  %-5s %s  %s\n' "$what" "$site" "$where"
+        ;;
+    *)
+        echo "$what $site $rest"
+        ;;
+    esac
+done
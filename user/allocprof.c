@@ -0,0 +1,18 @@
+#include <stdio.h>
+#include <string.h>
+#include <ulib.h>
+
+/* *
+ * allocprof - print the kernel memory by allocation call site, or "allocprof reset" to
+ * restart the peaks and counts. Feed the output to tools/allocprof.sh on the host to see
+ * the functions. The kernel must be built with ALLOC_PROF (kern/mm/alloc_prof.h).
+ * */
+int
+main(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "reset") == 0) {
+        reset_allocprof();
+        return 0;
+    }
+    print_allocprof();
+    return 0;
+}
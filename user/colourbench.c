@@ -0,0 +1,36 @@
+#include <ulib.h>
+#include <stdio.h>
+
+/* *
+ * colourbench - walk a buffer as large as the data cache, one word per cache line.
+ * When the kernel hands out pages of matching colour (PAGE_COLOUR_SHIFT in kern/mm/pmm.h)
+ * the buffer fits in the cache exactly; with random colours some of its pages collide in
+ * the same sets and the walk keeps missing. Run it on kernels built with PAGE_COLOUR_SHIFT
+ * 0 and 2 and compare the times. It only reports the time, there is no verdict: QEMU does
+ * not model the caches, so the difference shows on real hardware only.
+ * */
+
+#define PGSIZE          4096
+#define NR_COLOURS      4                   // keep in step with NR_PAGE_COLOURS
+#define CACHE_LINE      32
+#define ROUNDS          2000
+
+static char buf[NR_COLOURS * PGSIZE];       // BSS: faulted in page by page, each with its own colour
+
+int
+main(void) {
+    int i, round;
+    volatile int sum = 0;
+    for (i = 0; i < sizeof(buf); i += CACHE_LINE) {
+        buf[i] = i;
+    }
+    unsigned int start = gettime_msec();
+    for (round = 0; round < ROUNDS; round ++) {
+        for (i = 0; i < sizeof(buf); i += CACHE_LINE) {
+            sum += buf[i];
+        }
+    }
+    unsigned int used = gettime_msec() - start;
+    cprintf("colourbench: %d rounds over %d bytes in %d msec (sum %d).\n", ROUNDS, sizeof(buf), used, sum);
+    return 0;
+}
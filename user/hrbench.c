@@ -0,0 +1,53 @@
+#include <stdio.h>
+#include <ulib.h>
+#include <time.h>
+
+#define NROUND                          20
+
+/* *
+ * hrbench - time nanosleep with clock_gettime for a few delays below one tick (10ms),
+ * and print how much later than asked each one returned: the least, the most and the
+ * total over NROUND sleeps, in nanoseconds.
+ * */
+
+static const uint32_t delays[] = {50000, 200000, 1000000, 5000000};
+
+// the nanoseconds from t0 to t1, which are less than 2s apart
+static int
+elapsed_nsec(struct timespec *t0, struct timespec *t1) {
+    int nsec = (int)t1->tv_nsec - (int)t0->tv_nsec;
+    uint32_t sec;
+    for (sec = t0->tv_sec; sec != t1->tv_sec; sec ++) {
+        nsec += NSEC_PER_SEC;
+    }
+    return nsec;
+}
+
+int
+main(void) {
+    struct timespec req, t0, t1;
+    int i, r;
+    for (i = 0; i < sizeof(delays) / sizeof(delays[0]); i ++) {
+        int late, min_late = -1, max_late = 0, total_late = 0;
+        req.tv_sec = 0, req.tv_nsec = delays[i];
+        for (r = 0; r < NROUND; r ++) {
+            assert(clock_gettime(CLOCK_MONOTONIC, &t0) == 0);
+            assert(nanosleep(&req) == 0);
+            assert(clock_gettime(CLOCK_MONOTONIC, &t1) == 0);
+            late = elapsed_nsec(&t0, &t1) - (int)delays[i];
+            assert(late >= 0);
+            total_late += late;
+            if (min_late < 0 || late < min_late) {
+                min_late = late;
+            }
+            if (late > max_late) {
+                max_late = late;
+            }
+        }
+        cprintf("hrbench: nanosleep %8dns, late %8dns at least, %8dns at most, %10dns in total.\n",
+                delays[i], min_late, max_late, total_late);
+    }
+    cprintf("hrbench pass.\n");
+    return 0;
+}
+
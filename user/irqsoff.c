@@ -0,0 +1,19 @@
+#include <stdio.h>
+#include <string.h>
+#include <ulib.h>
+
+/* *
+ * irqsoff - print the longest time the kernel kept interrupts off, where it turned them
+ * off and on again, and a histogram of all such windows; "irqsoff reset" starts over.
+ * Feed the output to tools/irqsoff.sh on the host to see the functions. The kernel must
+ * be built with IRQSOFF_TRACE (kern/debug/irqsoff.h).
+ * */
+int
+main(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "reset") == 0) {
+        reset_irqsoff();
+        return 0;
+    }
+    print_irqsoff();
+    return 0;
+}
@@ -0,0 +1,29 @@
+#ifndef __USER_LIBS_ATOMIC_H__
+#define __USER_LIBS_ATOMIC_H__
+
+#include <defs.h>
+
+/* *
+ * Atomic operations on words of user memory. The CPU has no atomic instructions; these
+ * are restartable atomic sequences (atomic.S) that the kernel starts again when a thread
+ * is interrupted in the middle, so they need no syscall and no disabled interrupts.
+ * */
+
+int atomic_cmpxchg(volatile int *p, int old, int new);     // if *p == old, *p = new; return the old *p
+int atomic_xchg(volatile int *p, int new);                 // *p = new, return the old *p
+int atomic_fetch_add(volatile int *p, int v);              // *p += v, return the old *p
+bool test_and_set_bit(int nr, volatile uint32_t *addr);
+bool test_and_clear_bit(int nr, volatile uint32_t *addr);
+
+static inline int
+atomic_add_return(volatile int *p, int v) {
+    return atomic_fetch_add(p, v) + v;
+}
+
+static inline int
+atomic_sub_return(volatile int *p, int v) {
+    return atomic_fetch_add(p, -v) - v;
+}
+
+#endif /* !__USER_LIBS_ATOMIC_H__ */
+
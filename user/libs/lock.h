@@ -3,31 +3,12 @@
 
 #include <defs.h>
 #include <ulib.h>
+#include <atomic.h>
 
 #define INIT_LOCK           {0}
 
-typedef volatile bool lock_t;
-
-static __always_inline bool
-test_and_set_bit(int nr, volatile uint32_t *addr) {
-  //TODO
-  unsigned char c = 0;
-  if (*addr & (1 << nr))
-    c = 1;
-  *addr |= (1 << nr);
-  return c != 0;
-}
-
-static __always_inline bool
-test_and_clear_bit(int nr, volatile uint32_t *addr) {
-  //TODO
-  unsigned char c = 0;
-  if (*addr & (1 << nr))
-    c = 1;
-  *addr &= ~(1 << nr);
-  return c != 0;
-}
-
+// a spinlock that yields while it waits, bit 0 is the lock
+typedef volatile uint32_t lock_t;
 
 static inline void
 lock_init(lock_t *l) {
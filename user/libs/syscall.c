@@ -41,11 +41,31 @@ sys_exit(int error_code) {
     return syscall(SYS_exit, error_code);
 }
 
+int
+sys_exit_thread(int error_code) {
+    return syscall(SYS_exit_thread, error_code);
+}
+
 int
 sys_fork(void) {
     return syscall(SYS_fork);
 }
 
+int
+sys_clone(uint32_t clone_flags, uintptr_t stack, uintptr_t entry, uintptr_t arg) {
+    return syscall(SYS_clone, clone_flags, stack, entry, arg);
+}
+
+int
+sys_futex(volatile int *uaddr, int op, int val, int val2) {
+    return syscall(SYS_futex, uaddr, op, val, val2);
+}
+
+int
+sys_ras(uintptr_t start, size_t len) {
+    return syscall(SYS_ras, start, len);
+}
+
 int
 sys_wait(int pid, int *store) {
     return syscall(SYS_wait, pid, store);
@@ -61,6 +81,16 @@ sys_kill(int pid) {
     return syscall(SYS_kill, pid);
 }
 
+int
+sys_nice(int pid, int nice) {
+    return syscall(SYS_nice, pid, nice);
+}
+
+int
+sys_sched_setscheduler(int pid, int policy, int rt_priority) {
+    return syscall(SYS_sched_setscheduler, pid, policy, rt_priority);
+}
+
 int
 sys_getpid(void) {
     return syscall(SYS_getpid);
@@ -76,12 +106,52 @@ sys_pgdir(void) {
     return syscall(SYS_pgdir);
 }
 
+int
+sys_allocprof(int op) {
+    return syscall(SYS_allocprof, op);
+}
+
+int
+sys_schedlat(struct schedlat *lat, int flags) {
+    return syscall(SYS_schedlat, lat, flags);
+}
+
+int
+sys_irqsoff(int op) {
+    return syscall(SYS_irqsoff, op);
+}
+
+int
+sys_procinfo(struct procinfo *buf, int n) {
+    return syscall(SYS_procinfo, buf, n);
+}
+
+int
+sys_schedstat(int pid, struct schedstat *stat) {
+    return syscall(SYS_schedstat, pid, stat);
+}
+
 
 int
 sys_sleep(unsigned int time) {
     return syscall(SYS_sleep, time);
 }
 
+int
+sys_nanosleep(const struct timespec *req) {
+    return syscall(SYS_nanosleep, req);
+}
+
+int
+sys_clock_gettime(int clock, struct timespec *ts) {
+    return syscall(SYS_clock_gettime, clock, ts);
+}
+
+void
+sys_lab6_set_priority(uint32_t priority) {
+    syscall(SYS_lab6_set_priority, priority);
+}
+
 size_t
 sys_gettime(void) {
     return syscall(SYS_gettime);
@@ -92,6 +162,11 @@ sys_exec(const char *name, int argc, const char **argv) {
     return syscall(SYS_exec, name, argc, argv);
 }
 
+int
+sys_spawn(int argc, const char **argv, int fd_in, int fd_out) {
+    return syscall(SYS_spawn, argc, argv, fd_in, fd_out);
+}
+
 int
 sys_open(const char *path, uint32_t open_flags) {
     return syscall(SYS_open, path, open_flags);
@@ -1,16 +1,35 @@
 #ifndef __USER_LIBS_SYSCALL_H__
 #define __USER_LIBS_SYSCALL_H__
 
+struct procinfo;
+struct schedstat;
+struct schedlat;
+struct timespec;
+
 int sys_exit(int error_code);
+int sys_exit_thread(int error_code);
 int sys_fork(void);
+int sys_clone(uint32_t clone_flags, uintptr_t stack, uintptr_t entry, uintptr_t arg);
+int sys_futex(volatile int *uaddr, int op, int val, int val2);
+int sys_ras(uintptr_t start, size_t len);
 int sys_wait(int pid, int *store);
 int sys_exec(const char *name, int argc, const char **argv);
+int sys_spawn(int argc, const char **argv, int fd_in, int fd_out);
 int sys_yield(void);
 int sys_kill(int pid);
+int sys_nice(int pid, int nice);
+int sys_sched_setscheduler(int pid, int policy, int rt_priority);
 int sys_getpid(void);
 int sys_putc(int c);
 int sys_pgdir(void);
+int sys_allocprof(int op);
+int sys_schedlat(struct schedlat *lat, int flags);
+int sys_irqsoff(int op);
+int sys_procinfo(struct procinfo *buf, int n);
+int sys_schedstat(int pid, struct schedstat *stat);
 int sys_sleep(unsigned int time);
+int sys_nanosleep(const struct timespec *req);
+int sys_clock_gettime(int clock, struct timespec *ts);
 size_t sys_gettime(void);
 
 struct stat;
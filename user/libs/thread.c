@@ -0,0 +1,87 @@
+#include <defs.h>
+#include <syscall.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <ulib.h>
+#include <atomic.h>
+#include <thread.h>
+
+// what a new thread finds at the top of its stack
+struct thread_start {
+    int (*fn)(void *);
+    void *arg;
+};
+
+static void __noreturn
+thread_entry(struct thread_start *ts) {
+    thread_exit(ts->fn(ts->arg));
+}
+
+int
+thread_create(thread_t *thread, int (*fn)(void *), void *arg, void *stack, size_t stack_size) {
+    uintptr_t top = ROUNDDOWN_2N((uintptr_t)stack + stack_size, 3);
+    struct thread_start *ts = (struct thread_start *)top - 1;
+    ts->fn = fn, ts->arg = arg;
+    // leave the o32 argument save area of thread_entry below ts
+    uintptr_t sp = ROUNDDOWN_2N((uintptr_t)ts - 4 * sizeof(uint32_t), 3);
+    int tid = sys_clone(CLONE_VM | CLONE_THREAD | CLONE_FS, sp, (uintptr_t)thread_entry, (uintptr_t)ts);
+    if (tid < 0) {
+        return tid;
+    }
+    thread->tid = tid;
+    return 0;
+}
+
+int
+thread_join(thread_t *thread, int *exit_code) {
+    return waitpid(thread->tid, exit_code);
+}
+
+void
+thread_exit(int exit_code) {
+    sys_exit_thread(exit_code);
+    cprintf("BUG: thread_exit failed.\n");
+    while (1);
+}
+
+int
+futex_wait(volatile int *uaddr, int val) {
+    return sys_futex(uaddr, FUTEX_WAIT, val, 0);
+}
+
+int
+futex_wake(volatile int *uaddr, int n) {
+    return sys_futex(uaddr, FUTEX_WAKE, n, 0);
+}
+
+void
+mutex_init(mutex_t *mutex) {
+    mutex->val = 0;
+}
+
+bool
+mutex_trylock(mutex_t *mutex) {
+    return mutex->val == 0 && atomic_cmpxchg(&(mutex->val), 0, 1) == 0;
+}
+
+void
+mutex_lock(mutex_t *mutex) {
+    int c;
+    if ((c = atomic_cmpxchg(&(mutex->val), 0, 1)) != 0) {
+        if (c != 2) {
+            c = atomic_xchg(&(mutex->val), 2);
+        }
+        while (c != 0) {
+            futex_wait(&(mutex->val), 2);
+            c = atomic_xchg(&(mutex->val), 2);
+        }
+    }
+}
+
+void
+mutex_unlock(mutex_t *mutex) {
+    if (atomic_xchg(&(mutex->val), 0) == 2) {
+        futex_wake(&(mutex->val), 1);
+    }
+}
+
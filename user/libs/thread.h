@@ -0,0 +1,39 @@
+#ifndef __USER_LIBS_THREAD_H__
+#define __USER_LIBS_THREAD_H__
+
+#include <defs.h>
+
+/* *
+ * Threads share the memory and the files of their process (SYS_clone with CLONE_THREAD).
+ * The caller gives each thread its stack. exit() ends the whole process, thread_exit()
+ * or returning from fn ends one thread, whose exit code thread_join collects.
+ * */
+typedef struct {
+    int tid;
+} thread_t;
+
+/* *
+ * A mutex is a futex word: 0 unlocked, 1 locked, 2 locked and someone may be sleeping
+ * on it. It changes state with the atomics of atomic.h, so only a contended mutex enters
+ * the kernel.
+ * */
+typedef struct {
+    volatile int val;
+} mutex_t;
+
+#define MUTEX_INIT                      {0}
+
+int thread_create(thread_t *thread, int (*fn)(void *), void *arg, void *stack, size_t stack_size);
+int thread_join(thread_t *thread, int *exit_code);
+void __noreturn thread_exit(int exit_code);
+
+int futex_wait(volatile int *uaddr, int val);
+int futex_wake(volatile int *uaddr, int n);
+
+void mutex_init(mutex_t *mutex);
+bool mutex_trylock(mutex_t *mutex);
+void mutex_lock(mutex_t *mutex);
+void mutex_unlock(mutex_t *mutex);
+
+#endif /* !__USER_LIBS_THREAD_H__ */
+
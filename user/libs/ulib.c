@@ -1,5 +1,6 @@
 #include <defs.h>
 #include <syscall.h>
+#include <unistd.h>
 #include <stdio.h>
 #include <ulib.h>
 #include <stat.h>
@@ -50,6 +51,18 @@ kill(int pid) {
     return sys_kill(pid);
 }
 
+//nice - set the nice value of pid (0 for the caller), NICE_MIN..NICE_MAX in procinfo.h
+int
+nice(int pid, int nice) {
+    return sys_nice(pid, nice);
+}
+
+//sched_setscheduler - set the policy (SCHED_* in procinfo.h) and real time priority of pid
+int
+sched_setscheduler(int pid, int policy, int rt_priority) {
+    return sys_sched_setscheduler(pid, policy, rt_priority);
+}
+
 int
 getpid(void) {
     return sys_getpid();
@@ -61,11 +74,71 @@ print_pgdir(void) {
     sys_pgdir();
 }
 
+//print_allocprof - print the kernel allocations by call site (see kern/mm/alloc_prof.c)
+void
+print_allocprof(void) {
+    sys_allocprof(ALLOCPROF_PRINT);
+}
+
+//reset_allocprof - restart the peaks and allocation counts of the kernel allocation profile
+void
+reset_allocprof(void) {
+    sys_allocprof(ALLOCPROF_RESET);
+}
+
+//print_irqsoff - print the longest interrupts-off window of the kernel and a histogram (see kern/debug/irqsoff.c)
+void
+print_irqsoff(void) {
+    sys_irqsoff(IRQSOFF_PRINT);
+}
+
+//reset_irqsoff - forget the interrupts-off windows seen so far
+void
+reset_irqsoff(void) {
+    sys_irqsoff(IRQSOFF_RESET);
+}
+
+//procinfo - a snapshot of at most n processes, return how many were copied to buf
+int
+procinfo(struct procinfo *buf, int n) {
+    return sys_procinfo(buf, n);
+}
+
+//schedstat - the scheduler statistics of pid (0 for the caller)
+int
+schedstat(int pid, struct schedstat *stat) {
+    return sys_schedstat(pid, stat);
+}
+
+//schedlat - the system wide scheduler latencies, cleared afterwards if flags has SCHEDLAT_RESET
+int
+schedlat(struct schedlat *lat, int flags) {
+    return sys_schedlat(lat, flags);
+}
+
 int
 sleep(unsigned int time) {
     return sys_sleep(time);
 }
 
+//nanosleep - sleep for req, with a resolution well below a tick
+int
+nanosleep(const struct timespec *req) {
+    return sys_nanosleep(req);
+}
+
+//clock_gettime - the time since boot of clock, CLOCK_* in time.h
+int
+clock_gettime(int clock, struct timespec *ts) {
+    return sys_clock_gettime(clock, ts);
+}
+
+//lab6_set_priority - 0 is the default and the highest, larger numbers run less often
+void
+lab6_set_priority(uint32_t priority) {
+    sys_lab6_set_priority(priority);
+}
+
 unsigned int
 gettime_msec(void) {
     return (unsigned int)sys_gettime();
@@ -80,3 +153,13 @@ __exec(const char *name, const char **argv) {
     return sys_exec(name, argc, argv);
 }
 
+// spawn - run argv[0] in a new child with fd_in / fd_out as its stdin / stdout (-1: closed)
+int
+spawn(const char **argv, int fd_in, int fd_out) {
+    int argc = 0;
+    while (argv[argc] != NULL) {
+        argc ++;
+    }
+    return sys_spawn(argc, argv, fd_in, fd_out);
+}
+
@@ -3,6 +3,11 @@
 
 #include <defs.h>
 
+struct procinfo;
+struct schedstat;
+struct schedlat;
+struct timespec;
+
 void __warn(const char *file, int line, const char *fmt, ...);
 void __noreturn __panic(const char *file, int line, const char *fmt, ...);
 
@@ -31,11 +36,23 @@ int wait(void);
 int waitpid(int pid, int *store);
 void yield(void);
 int kill(int pid);
+int nice(int pid, int nice);
+int sched_setscheduler(int pid, int policy, int rt_priority);
 int getpid(void);
 void print_pgdir(void);
+void print_allocprof(void);
+void reset_allocprof(void);
+void print_irqsoff(void);
+void reset_irqsoff(void);
+int procinfo(struct procinfo *buf, int n);
+int schedstat(int pid, struct schedstat *stat);
+int schedlat(struct schedlat *lat, int flags);
 int sleep(unsigned int time);
+int nanosleep(const struct timespec *req);
+int clock_gettime(int clock, struct timespec *ts);
 unsigned int gettime_msec(void);
 int __exec(const char *name, const char **argv);
+int spawn(const char **argv, int fd_in, int fd_out);
 
 #define __exec0(name, path, ...)                \
 ({ const char *argv[] = {path, ##__VA_ARGS__, NULL}; __exec(name, argv); })
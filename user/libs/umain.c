@@ -2,12 +2,33 @@
 #include <unistd.h>
 #include <file.h>
 #include <stat.h>
+#include <syscall.h>
 
 int main(int argc, char *argv[]);
 
+// the restartable atomic sequences of atomic.S, as (start, end) pairs ending with 0
+extern uintptr_t __ras_table[];
+
+static int
+initras(void) {
+    uintptr_t *r;
+    int ret;
+    for (r = __ras_table; r[0] != 0; r += 2) {
+        if ((ret = sys_ras(r[0], r[1] - r[0])) != 0) {
+            return ret;
+        }
+    }
+    return 0;
+}
+
+// initfd - open path as fd2, unless fd2 is already open (given by spawn)
 static int
 initfd(int fd2, const char *path, uint32_t open_flags) {
-    int fd1, ret;
+    int fd1, ret = 0;
+    struct stat st;
+    if (fstat(fd2, &st) == 0) {
+        return fd2;
+    }
     if ((fd1 = open(path, open_flags)) < 0) {
         return fd1;
     }
@@ -22,6 +43,9 @@ initfd(int fd2, const char *path, uint32_t open_flags) {
 void
 umain(int argc, char *argv[]) {
     int fd;
+    if ((fd = initras()) != 0) {
+        warn("register atomic sequences failed: %e.\n", fd);
+    }
     if ((fd = initfd(0, "stdin:", O_RDONLY)) < 0) {
         warn("open <stdin> failed: %e.\n", fd);
     }
@@ -0,0 +1,73 @@
+#include <stdio.h>
+#include <string.h>
+#include <ulib.h>
+#include <procinfo.h>
+
+#define NBATCH                          4       // # of CPU-bound children
+#define NSLEEP                          50      // # of sleeps timed by the interactive parent
+
+/* *
+ * schedbench - an interactive process against CPU-bound batch jobs. The parent sleeps one
+ * tick NSLEEP times and reports how late it woke up, while NBATCH children spin; the last
+ * child runs at the lowest priority. The parent, which always blocks, stays at the top
+ * level of mlfq_sched_class, or gets the sleeper credit of fair_sched_class, so its
+ * lateness is about one tick whatever NBATCH is.
+ *
+ * schedbench rt - the parent is SCHED_FIFO, and the first child a runaway SCHED_FIFO
+ * process at a lower priority. The parent still preempts it at once, and the throttling
+ * of the real time class leaves the batch children a share of the CPU.
+ * */
+
+static void
+spin(void) {
+    volatile uint32_t n = 0;
+    while (1) {
+        n ++;
+    }
+}
+
+int
+main(int argc, char **argv) {
+    int pids[NBATCH], i;
+    bool rt = (argc > 1 && strcmp(argv[1], "rt") == 0);
+    if (rt) {
+        assert(sched_setscheduler(0, SCHED_FIFO, RT_PRIO_MAX - 1) == 0);
+    }
+    for (i = 0; i < NBATCH; i ++) {
+        if ((pids[i] = fork()) == 0) {
+            if (rt && i == 0) {
+                assert(sched_setscheduler(0, SCHED_FIFO, RT_PRIO_MIN) == 0);
+            }
+            else {
+                assert(sched_setscheduler(0, SCHED_NORMAL, 0) == 0);
+            }
+            if (i == NBATCH - 1) {
+                lab6_set_priority(NBATCH);
+                nice(0, NICE_MAX);
+            }
+            spin();
+        }
+        assert(pids[i] > 0);
+    }
+
+    unsigned int late, max_late = 0, total_late = 0;
+    for (i = 0; i < NSLEEP; i ++) {
+        unsigned int start = gettime_msec();
+        sleep(1);
+        late = gettime_msec() - start - 1;
+        total_late += late;
+        if (late > max_late) {
+            max_late = late;
+        }
+    }
+    cprintf("schedbench: %d %s sleeps with %d batch jobs, late %d ticks in total, %d at most.\n",
+            NSLEEP, rt ? "SCHED_FIFO" : "SCHED_NORMAL", NBATCH, total_late, max_late);
+
+    for (i = 0; i < NBATCH; i ++) {
+        assert(kill(pids[i]) == 0);
+        waitpid(pids[i], NULL);
+    }
+    cprintf("schedbench pass.\n");
+    return 0;
+}
+
@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include <string.h>
+#include <ulib.h>
+#include <thumips.h>
+#include <procinfo.h>
+
+#define SCHEDLAT_MAX                    64      // the most processes shown
+
+// CP0 Count runs at 100MHz, 10ns per cycle; there is no divide
+#define COUNT_TO_NSEC(c)                __mulu10(c)
+
+/* *
+ * schedlat - print the scheduler latencies: how long processes waited from wakeup_proc
+ * until they ran, and all the waits on the run queue, as histograms in nanoseconds; the
+ * run queue length sampled every tick; and why processes gave up the CPU: the time slice
+ * ran out (EXPIRED), preempted or yielded while runnable (PREEMPT), or went to sleep
+ * (BLOCKED). Then the same per process, with the median (P50) and the longest wakeup
+ * latency. "schedlat reset" prints the system wide numbers and starts them over.
+ * */
+
+static struct procinfo procs[SCHEDLAT_MAX];
+
+// the upper bound of bucket i in ns, 0 for the last one, which has no bound
+static uint32_t
+bucket_nsec(int i) {
+    return (i < SCHEDLAT_NBUCKET - 1) ? COUNT_TO_NSEC(1 << (i + SCHEDLAT_MIN_SHIFT)) : 0;
+}
+
+// the bucket that holds the median of hist, -1 if it is empty
+static int
+median_bucket(const uint32_t *hist) {
+    uint32_t total = 0, sum = 0;
+    int i;
+    for (i = 0; i < SCHEDLAT_NBUCKET; i ++) {
+        total += hist[i];
+    }
+    for (i = 0; i < SCHEDLAT_NBUCKET && total != 0; i ++) {
+        if (((sum += hist[i]) << 1) >= total) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void
+print_system(struct schedlat *lat) {
+    int i;
+    cprintf("schedlat: max wakeup latency %d ns, pid %d\n",
+            COUNT_TO_NSEC(lat->max_wakeup), lat->max_wakeup_pid);
+    cprintf("       LATENCY      WAKEUP      WAIT\n");
+    for (i = 0; i < SCHEDLAT_NBUCKET; i ++) {
+        if (lat->wakeup_hist[i] == 0 && lat->wait_hist[i] == 0) {
+            continue ;
+        }
+        if (i < SCHEDLAT_NBUCKET - 1) {
+            cprintf("  < %9d ns %9d %9d\n", bucket_nsec(i), lat->wakeup_hist[i], lat->wait_hist[i]);
+        }
+        else {
+            cprintf("  >=%9d ns %9d %9d\n", bucket_nsec(i - 1), lat->wakeup_hist[i], lat->wait_hist[i]);
+        }
+    }
+    cprintf("schedlat: run queue length per tick, max %d\n", lat->max_rqlen);
+    for (i = 0; i < RQLEN_NBUCKET; i ++) {
+        if (lat->rqlen_hist[i] != 0) {
+            cprintf("  %3d%c %9d\n", i, (i < RQLEN_NBUCKET - 1) ? ' ' : '+', lat->rqlen_hist[i]);
+        }
+    }
+    cprintf("schedlat: expired %d, preempted %d, blocked %d\n", lat->nr_switch[SWITCH_EXPIRED],
+            lat->nr_switch[SWITCH_PREEMPTED], lat->nr_switch[SWITCH_BLOCKED]);
+}
+
+static void
+print_procs(void) {
+    struct schedstat stat;
+    int n, i, m;
+    if ((n = procinfo(procs, SCHEDLAT_MAX)) < 0) {
+        cprintf("schedlat: procinfo failed: %e.\n", n);
+        return ;
+    }
+    cprintf("  PID  EXPIRED  PREEMPT  BLOCKED  WAKEUPS    P50 (ns)    MAX (ns) NAME\n");
+    for (i = 0; i < n; i ++) {
+        // idle is not scheduled by any class, and pid 0 means the caller
+        if (procs[i].pid == 0 || schedstat(procs[i].pid, &stat) != 0) {
+            continue ;
+        }
+        // the median as the bound of its bucket: "< bound", or ">= bound" for the last one
+        bool last = ((m = median_bucket(stat.wakeup_hist)) == SCHEDLAT_NBUCKET - 1);
+        uint32_t p50 = (m < 0) ? 0 : bucket_nsec(last ? m - 1 : m);
+        cprintf("%5d %8d %8d %8d %8d %c%10d %11d %s\n", stat.pid, stat.nr_switch[SWITCH_EXPIRED],
+                stat.nr_switch[SWITCH_PREEMPTED], stat.nr_switch[SWITCH_BLOCKED], stat.nr_wakeups,
+                last ? '>' : '<', p50, COUNT_TO_NSEC(stat.max_wakeup), procs[i].name);
+    }
+}
+
+int
+main(int argc, char **argv) {
+    struct schedlat lat;
+    int reset = (argc > 1 && strcmp(argv[1], "reset") == 0), ret;
+    if ((ret = schedlat(&lat, reset ? SCHEDLAT_RESET : 0)) != 0) {
+        cprintf("schedlat: failed: %e.\n", ret);
+        return ret;
+    }
+    print_system(&lat);
+    if (!reset) {
+        print_procs();
+    }
+    return 0;
+}
@@ -0,0 +1,38 @@
+#include <stdio.h>
+#include <ulib.h>
+#include <procinfo.h>
+
+#define SCHEDSTAT_MAX                   64      // the most processes shown
+
+/* *
+ * schedstat - print the scheduler statistics of every process: the policy (N normal, F
+ * FIFO, R round robin) and real time priority, the nice value, the
+ * vruntime relative to the run queue's min_vruntime, the # of wakeups, the ticks spent
+ * runnable waiting for the CPU and the longest of those waits in CP0 Count cycles.
+ * */
+
+static struct procinfo procs[SCHEDSTAT_MAX];
+
+int
+main(void) {
+    struct schedstat stat;
+    int n, i;
+    if ((n = procinfo(procs, SCHEDSTAT_MAX)) < 0) {
+        cprintf("schedstat: procinfo failed: %e.\n", n);
+        return n;
+    }
+    static const char policy_char[] = {[SCHED_NORMAL] 'N', [SCHED_FIFO] 'F', [SCHED_RR] 'R'};
+    cprintf("  PID POL PRI  NI   VRUNTIME  WAKEUPS  DELAY   MAXDELAY NAME\n");
+    for (i = 0; i < n; i ++) {
+        // idle is not scheduled by any class, and pid 0 means the caller
+        if (procs[i].pid == 0 || schedstat(procs[i].pid, &stat) != 0) {
+            continue ;
+        }
+        cprintf("%5d   %c %3d %3d %10d %8d %6d %10d %s\n", stat.pid, policy_char[stat.policy],
+                stat.rt_priority, stat.nice,
+                (int)(stat.vruntime - stat.min_vruntime), stat.nr_wakeups,
+                stat.run_delay.ticks, stat.max_delay, procs[i].name);
+    }
+    return 0;
+}
+
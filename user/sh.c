@@ -113,105 +113,120 @@ testfile(const char *name) {
     return 0;
 }
 
+// redirect - open filename as the new stdin / stdout of the command, closing the old one
 int
-runcmd(char *cmd) {
+redirect(int *fdp, int std, const char *filename, uint32_t open_flags) {
+    int fd;
+    if ((fd = open(filename, open_flags)) < 0) {
+        return fd;
+    }
+    if (*fdp != std) {
+        close(*fdp);
+    }
+    *fdp = fd;
+    return 0;
+}
+
+// runit - spawn argv[0] with fd_in / fd_out as its stdin / stdout and wait for it
+int
+runit(int argc, const char **argv, int fd_in, int fd_out) {
     static char argv0[BUFSIZE];
+    int ret, pid, code;
+    if (argc == 0) {
+        return 0;
+    }
+    else if (strcmp(argv[0], "cd") == 0) {
+        if (argc != 2) {
+            return -1;
+        }
+        strcpy(shcwd, argv[1]);
+        return 0;
+    }
+    if ((ret = testfile(argv[0])) != 0) {
+        if (ret != -E_NOENT) {
+            return ret;
+        }
+        snprintf(argv0, sizeof(argv0), "/%s", argv[0]);
+        argv[0] = argv0;
+    }
+    argv[argc] = NULL;
+    if ((pid = spawn(argv, fd_in, fd_out)) < 0) {
+        return pid;
+    }
+    if ((ret = waitpid(pid, &code)) != 0) {
+        return ret;
+    }
+    return code;
+}
+
+int
+runcmd(char *cmd) {
     const char *argv[EXEC_MAX_ARG_NUM + 1];
     char *t;
-    int argc, token, ret, p[2];
+    int argc, token, ret, fd_in, fd_out;
 again:
-    argc = 0;
+    argc = 0, fd_in = 0, fd_out = 1;
     while (1) {
         switch (token = gettoken(&cmd, &t)) {
         case 'w':
             if (argc == EXEC_MAX_ARG_NUM) {
                 printf("sh error: too many arguments\n");
-                return -1;
+                ret = -1;
+                goto out;
             }
             argv[argc ++] = t;
             break;
         case '<':
             if (gettoken(&cmd, &t) != 'w') {
                 printf("sh error: syntax error: < not followed by word\n");
-                return -1;
+                ret = -1;
+                goto out;
             }
-            if ((ret = reopen(0, t, O_RDONLY)) != 0) {
-                return ret;
+            if ((ret = redirect(&fd_in, 0, t, O_RDONLY)) != 0) {
+                goto out;
             }
             break;
         case '>':
             if (gettoken(&cmd, &t) != 'w') {
                 printf("sh error: syntax error: > not followed by word\n");
-                return -1;
+                ret = -1;
+                goto out;
             }
-            if ((ret = reopen(1, t, O_RDWR | O_TRUNC | O_CREAT)) != 0) {
-                return ret;
+            if ((ret = redirect(&fd_out, 1, t, O_RDWR | O_TRUNC | O_CREAT)) != 0) {
+                goto out;
             }
             break;
         case '|':
-          //  if ((ret = pipe(p)) != 0) {
-          //      return ret;
-          //  }
-            if ((ret = fork()) == 0) {
-                close(0);
-                if ((ret = dup2(p[0], 0)) < 0) {
-                    return ret;
-                }
-                close(p[0]), close(p[1]);
-                goto again;
-            }
-            else {
-                if (ret < 0) {
-                    return ret;
-                }
-                close(1);
-                if ((ret = dup2(p[1], 1)) < 0) {
-                    return ret;
-                }
-                close(p[0]), close(p[1]);
-                goto runit;
-            }
-            break;
+            printf("sh error: pipes are not supported\n");
+            ret = -1;
+            goto out;
         case 0:
-            goto runit;
+            ret = runit(argc, argv, fd_in, fd_out);
+            goto out;
         case ';':
-            if ((ret = fork()) == 0) {
-                goto runit;
+            ret = runit(argc, argv, fd_in, fd_out);
+            if (fd_in != 0) {
+                close(fd_in);
             }
-            else {
-                if (ret < 0) {
-                    return ret;
-                }
-                waitpid(ret, NULL);
-                goto again;
+            if (fd_out != 1) {
+                close(fd_out);
             }
-            break;
+            goto again;
         default:
             printf("sh error: bad return %d from gettoken\n", token);
-            return -1;
+            ret = -1;
+            goto out;
         }
     }
 
-runit:
-    if (argc == 0) {
-        return 0;
-    }
-    else if (strcmp(argv[0], "cd") == 0) {
-        if (argc != 2) {
-            return -1;
-        }
-        strcpy(shcwd, argv[1]);
-        return 0;
+out:
+    if (fd_in != 0) {
+        close(fd_in);
     }
-    if ((ret = testfile(argv[0])) != 0) {
-        if (ret != -E_NOENT) {
-            return ret;
-        }
-        snprintf(argv0, sizeof(argv0), "/%s", argv[0]);
-        argv[0] = argv0;
+    if (fd_out != 1) {
+        close(fd_out);
     }
-    argv[argc] = NULL;
-    return __exec(NULL, argv);
+    return ret;
 }
 
 int
@@ -235,19 +250,9 @@ main(int argc, char **argv) {
     while ((buffer = readline((interactive) ? "$ " : NULL)) != NULL) {
         printf("\r\n");
         shcwd[0] = '\0';
-        int pid;
-        if ((pid = fork()) == 0) {
-            ret = runcmd(buffer);
-            exit(ret);
-        }
-        assert(pid >= 0);
-        if (waitpid(pid, &ret) == 0) {
-            if (ret == 0 && shcwd[0] != '\0') {
-				ret = 0;
-            }
-            if (ret != 0) {
-                printf("error: %d - %e\n", ret, ret);
-            }
+        // commands are spawned, the shell itself is never copied
+        if ((ret = runcmd(buffer)) != 0) {
+            printf("error: %d - %e\n", ret, ret);
         }
     }
     return 0;
@@ -0,0 +1,77 @@
+#include <stdio.h>
+#include <ulib.h>
+#include <thread.h>
+#include <atomic.h>
+
+#define NSLEEPER                        1000    // # of sleeping threads by default
+#define NSLEEPER_MAX                    2048
+#define NROUND                          8       // # of sleeps of each sleeper
+#define NPROBE                          50      // # of one tick sleeps timed by the main thread
+#define STACKSIZE                       512
+
+/* *
+ * sleepbench [n] - n threads (NSLEEPER by default) sleep NROUND times each, for 1..64
+ * ticks at random, so thousands of timers are pending at once. Meanwhile the main thread
+ * sleeps one tick NPROBE times and reports how late it woke up, which should not grow
+ * with n: adding, deleting and expiring a timer take constant time.
+ * */
+
+static char stacks[NSLEEPER_MAX][STACKSIZE];
+static thread_t threads[NSLEEPER_MAX];
+static volatile int nr_wakeups;
+
+static int
+sleeper(void *arg) {
+    uint32_t x = (uint32_t)arg + 1;
+    int i;
+    for (i = 0; i < NROUND; i ++) {
+        x ^= x << 13, x ^= x >> 17, x ^= x << 5;
+        sleep(1 + (x & 63));
+        atomic_fetch_add(&nr_wakeups, 1);
+    }
+    return 0;
+}
+
+int
+main(int argc, char **argv) {
+    int n = NSLEEPER, i, code;
+    if (argc > 1) {
+        const char *s;
+        for (n = 0, s = argv[1]; *s >= '0' && *s <= '9'; s ++) {
+            n = (n << 3) + (n << 1) + (*s - '0');
+        }
+        if (n > NSLEEPER_MAX) {
+            n = NSLEEPER_MAX;
+        }
+    }
+
+    unsigned int start = gettime_msec();
+    for (i = 0; i < n; i ++) {
+        if (thread_create(threads + i, sleeper, (void *)i, stacks[i], STACKSIZE) != 0) {
+            cprintf("sleepbench: only %d sleepers could be created.\n", i);
+            n = i;
+            break;
+        }
+    }
+
+    unsigned int late, max_late = 0, total_late = 0;
+    for (i = 0; i < NPROBE; i ++) {
+        unsigned int probe = gettime_msec();
+        sleep(1);
+        late = gettime_msec() - probe - 1;
+        total_late += late;
+        if (late > max_late) {
+            max_late = late;
+        }
+    }
+
+    for (i = 0; i < n; i ++) {
+        assert(thread_join(threads + i, &code) == 0 && code == 0);
+    }
+    assert(nr_wakeups == n * NROUND);
+    cprintf("sleepbench: %d sleepers, %d wakeups in %d ticks.\n", n, nr_wakeups, gettime_msec() - start);
+    cprintf("sleepbench: %d probes late %d ticks in total, %d at most.\n", NPROBE, total_late, max_late);
+    cprintf("sleepbench pass.\n");
+    return 0;
+}
+
@@ -0,0 +1,44 @@
+#include <ulib.h>
+#include <stdio.h>
+#include <thread.h>
+#include <atomic.h>
+
+#define NTHREAD                         8
+#define NLOOP                           200
+#define STACKSIZE                       4096
+
+static char stacks[NTHREAD][STACKSIZE];
+static mutex_t mutex = MUTEX_INIT;
+static volatile int counter, acounter;
+
+static int
+worker(void *arg) {
+    int i, id = (int)arg;
+    for (i = 0; i < NLOOP; i ++) {
+        mutex_lock(&mutex);
+        int c = counter;
+        if (i % 16 == id) {
+            yield();            // give the others a chance to find the mutex held
+        }
+        counter = c + 1;
+        mutex_unlock(&mutex);
+        atomic_fetch_add(&acounter, 1);
+    }
+    return id;
+}
+
+int
+main(void) {
+    thread_t threads[NTHREAD];
+    int i, code;
+    for (i = 0; i < NTHREAD; i ++) {
+        assert(thread_create(threads + i, worker, (void *)i, stacks[i], STACKSIZE) == 0);
+    }
+    for (i = 0; i < NTHREAD; i ++) {
+        assert(thread_join(threads + i, &code) == 0 && code == i);
+    }
+    assert(counter == NTHREAD * NLOOP && acounter == NTHREAD * NLOOP);
+    cprintf("threadtest pass.\n");
+    return 0;
+}
+
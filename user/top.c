@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include <string.h>
+#include <ulib.h>
+#include <procinfo.h>
+
+#define TOP_MAX                         64      // the most processes shown
+#define TOP_INTERVAL                    100     // ticks between two refreshes
+#define TOP_ROUNDS                      10
+
+/* *
+ * top [rounds] - print the processes every TOP_INTERVAL ticks, the busiest first. CPU is
+ * the ticks a process ran since the last refresh, out of the ticks in the header; USER,
+ * SYS and IRQ are the totals since it started. VCSW / IVCSW count the times it gave up
+ * the CPU by sleeping / was switched away while runnable.
+ * */
+
+static struct procinfo snap[2][TOP_MAX];
+
+static uint32_t
+busy_ticks(struct procinfo *info) {
+    return info->times[CPUTIME_USER].ticks + info->times[CPUTIME_SYS].ticks
+        + info->times[CPUTIME_IRQ].ticks;
+}
+
+// the busy ticks of pid in the last snapshot, 0 if it was not there
+static uint32_t
+last_busy_ticks(struct procinfo *last, int nlast, int pid) {
+    int i;
+    for (i = 0; i < nlast; i ++) {
+        if (last[i].pid == pid) {
+            return busy_ticks(last + i);
+        }
+    }
+    return 0;
+}
+
+static void
+print_snapshot(struct procinfo *cur, int n, struct procinfo *last, int nlast, unsigned int elapsed) {
+    uint32_t delta[TOP_MAX];
+    bool printed[TOP_MAX];
+    int i, k;
+    for (i = 0; i < n; i ++) {
+        delta[i] = busy_ticks(cur + i) - last_busy_ticks(last, nlast, cur[i].pid);
+        printed[i] = 0;
+    }
+    cprintf("\ntop: %d processes, %d ticks since the last refresh\n", n, elapsed);
+    cprintf("  PID  PPID S   CPU   USER    SYS    IRQ   VCSW  IVCSW NAME\n");
+    for (k = 0; k < n; k ++) {
+        int max = -1;
+        for (i = 0; i < n; i ++) {
+            if (!printed[i] && (max < 0 || delta[i] > delta[max])) {
+                max = i;
+            }
+        }
+        printed[max] = 1;
+        struct procinfo *info = cur + max;
+        cprintf("%5d %5d %c %5d %6d %6d %6d %6d %6d %s\n", info->pid, info->ppid, info->state,
+                delta[max], info->times[CPUTIME_USER].ticks, info->times[CPUTIME_SYS].ticks,
+                info->times[CPUTIME_IRQ].ticks, info->nvcsw, info->nivcsw, info->name);
+    }
+}
+
+int
+main(int argc, char **argv) {
+    int rounds = TOP_ROUNDS, r, n, nlast = 0;
+    if (argc > 1) {
+        const char *s;
+        for (rounds = 0, s = argv[1]; *s >= '0' && *s <= '9'; s ++) {
+            rounds = (rounds << 3) + (rounds << 1) + (*s - '0');
+        }
+    }
+    unsigned int now, last_time = gettime_msec();
+    for (r = 0; r < rounds; r ++) {
+        struct procinfo *cur = snap[r & 1], *last = snap[!(r & 1)];
+        if ((n = procinfo(cur, TOP_MAX)) < 0) {
+            cprintf("top: procinfo failed: %e.\n", n);
+            return n;
+        }
+        now = gettime_msec();
+        print_snapshot(cur, n, last, nlast, now - last_time);
+        nlast = n, last_time = now;
+        if (r + 1 < rounds) {
+            sleep(TOP_INTERVAL);
+        }
+    }
+    return 0;
+}
+